@@ -17,6 +17,28 @@ const ENVELOPE_TYPE_EVENT = 'event';
 const ENVELOPE_TYPE_ACK_REQUEST = 'ack_request';
 const ENVELOPE_TYPE_ACK_RESPONSE = 'ack_response';
 
+// Binary envelope layout:
+//   event:        0xC1, type|NAME?, varint event id, [name], args
+//   ack request:  0xC1, type|NAME?, varint event id, [name], varint ack id, args
+//   ack response: 0xC1, type, varint ack id, args
+// Event names are interned per connection on framed streams: the first
+// envelope for a name sets BINARY_FLAG_NAME and carries it as a MessagePack
+// string, later ones send only the id. Everywhere else the id is 0 and the
+// name is always carried: a datagram may be lost, and on an unframed stream
+// an envelope may arrive merged with or split across others.
+// args is a MessagePack array; Uint8Array and ArrayBuffer arguments travel
+// as bin and arrive as Uint8Array views of the received chunk.
+// 0xC1 starts neither UTF-8 text nor MessagePack, so a single byte tells a
+// binary envelope apart from application data and JSON envelopes.
+const BINARY_ENVELOPE_MAGIC = 0xc1;
+const BINARY_FLAG_NAME = 0x80;
+const BINARY_TYPES = { [ENVELOPE_TYPE_EVENT]: 1, [ENVELOPE_TYPE_ACK_REQUEST]: 2, [ENVELOPE_TYPE_ACK_RESPONSE]: 3 };
+const BINARY_TYPE_NAMES = [null, ENVELOPE_TYPE_EVENT, ENVELOPE_TYPE_ACK_REQUEST, ENVELOPE_TYPE_ACK_RESPONSE];
+const JSON_ENVELOPE_START = 0x7b; // '{'
+
+const textEncoder = new TextEncoder();
+const textDecoder = new TextDecoder();
+
 function ensureSupported(name, value) {
   if (!value) throw new Error(`${name} is not available in this runtime`);
 }
@@ -43,11 +65,538 @@ function maybeParseEnvelope(value) {
   return null;
 }
 
+// Growable scratch buffer shared by all connections: an envelope is built here
+// and copied out once, so encoding allocates a single Uint8Array per message.
+class EnvelopeWriter {
+  constructor() {
+    this.buf = new Uint8Array(1024);
+    this.view = new DataView(this.buf.buffer);
+    this.pos = 0;
+  }
+
+  reserve(n) {
+    if (this.pos + n <= this.buf.length) return;
+    let size = this.buf.length * 2;
+    while (size < this.pos + n) size *= 2;
+    const next = new Uint8Array(size);
+    next.set(this.buf.subarray(0, this.pos));
+    this.buf = next;
+    this.view = new DataView(next.buffer);
+  }
+
+  u8(v) {
+    this.reserve(1);
+    this.buf[this.pos++] = v;
+  }
+
+  varint(v) {
+    this.reserve(5);
+    while (v >= 0x80) {
+      this.buf[this.pos++] = (v & 0x7f) | 0x80;
+      v >>>= 7;
+    }
+    this.buf[this.pos++] = v;
+  }
+
+  // Type byte followed by an 8, 16 or 32-bit big-endian length
+  header(small, length) {
+    this.reserve(5);
+    if (length < 0x100) {
+      this.buf[this.pos++] = small;
+      this.buf[this.pos++] = length;
+    } else if (length < 0x10000) {
+      this.buf[this.pos++] = small + 1;
+      this.view.setUint16(this.pos, length);
+      this.pos += 2;
+    } else {
+      this.buf[this.pos++] = small + 2;
+      this.view.setUint32(this.pos, length);
+      this.pos += 4;
+    }
+  }
+
+  bytes(b) {
+    this.header(0xc4, b.length);
+    this.reserve(b.length);
+    this.buf.set(b, this.pos);
+    this.pos += b.length;
+  }
+
+  // The length prefix is sized for the worst case (3 bytes per UTF-16 unit)
+  // and patched after encodeInto; short strings still get a fixstr, and
+  // short ASCII ones (keys, event names) skip the encodeInto call
+  string(str) {
+    const n = str.length;
+    if (n < 32) {
+      this.reserve(1 + n);
+      const buf = this.buf;
+      let i = 0;
+      while (i < n) {
+        const c = str.charCodeAt(i);
+        if (c >= 0x80) break;
+        buf[this.pos + 1 + i++] = c;
+      }
+      if (i === n) {
+        buf[this.pos] = 0xa0 | n;
+        this.pos += 1 + n;
+        return;
+      }
+    }
+    const max = n * 3;
+    this.reserve(5 + max);
+    let start;
+    if (max < 32) {
+      start = this.pos++;
+    } else {
+      this.header(0xd9, max);
+      start = this.pos;
+    }
+    const written = textEncoder.encodeInto(str, this.buf.subarray(this.pos)).written;
+    if (max < 32) {
+      this.buf[start] = 0xa0 | written;
+    } else if (max < 0x100) {
+      this.buf[start - 1] = written;
+    } else if (max < 0x10000) {
+      this.view.setUint16(start - 2, written);
+    } else {
+      this.view.setUint32(start - 4, written);
+    }
+    this.pos += written;
+  }
+
+  container(fix, big, count) {
+    this.reserve(5);
+    if (count < 16) {
+      this.buf[this.pos++] = fix | count;
+    } else if (count < 0x10000) {
+      this.buf[this.pos++] = big;
+      this.view.setUint16(this.pos, count);
+      this.pos += 2;
+    } else {
+      this.buf[this.pos++] = big + 1;
+      this.view.setUint32(this.pos, count);
+      this.pos += 4;
+    }
+  }
+
+  // MessagePack, following JSON.stringify for what has no JSON form:
+  // undefined and functions become nil (and are skipped as object values),
+  // toJSON() is honored, and BigInt throws
+  value(v) {
+    switch (typeof v) {
+      case 'string':
+        return this.string(v);
+      case 'number':
+        return this.number(v);
+      case 'boolean':
+        return this.u8(v ? 0xc3 : 0xc2);
+      case 'bigint':
+        throw new TypeError('Do not know how to serialize a BigInt');
+      case 'object':
+        if (v === null) break;
+        if (v instanceof Uint8Array) return this.bytes(v);
+        if (v instanceof ArrayBuffer) return this.bytes(new Uint8Array(v));
+        if (ArrayBuffer.isView(v)) return this.bytes(new Uint8Array(v.buffer, v.byteOffset, v.byteLength));
+        if (Array.isArray(v)) {
+          this.container(0x90, 0xdc, v.length);
+          for (let i = 0; i < v.length; i++) this.value(v[i]);
+          return;
+        }
+        if (typeof v.toJSON === 'function') return this.value(v.toJSON());
+        return this.object(v);
+    }
+    this.u8(0xc0);
+  }
+
+  number(v) {
+    this.reserve(9);
+    if (Number.isInteger(v) && v >= -0x80000000 && v <= 0xffffffff) {
+      if (v >= 0) {
+        if (v < 0x80) {
+          this.buf[this.pos++] = v;
+        } else if (v < 0x100) {
+          this.buf[this.pos++] = 0xcc;
+          this.buf[this.pos++] = v;
+        } else if (v < 0x10000) {
+          this.buf[this.pos++] = 0xcd;
+          this.view.setUint16(this.pos, v);
+          this.pos += 2;
+        } else {
+          this.buf[this.pos++] = 0xce;
+          this.view.setUint32(this.pos, v);
+          this.pos += 4;
+        }
+        return;
+      }
+      if (v >= -32) {
+        this.buf[this.pos++] = v & 0xff;
+      } else if (v >= -0x80) {
+        this.buf[this.pos++] = 0xd0;
+        this.view.setInt8(this.pos++, v);
+      } else if (v >= -0x8000) {
+        this.buf[this.pos++] = 0xd1;
+        this.view.setInt16(this.pos, v);
+        this.pos += 2;
+      } else {
+        this.buf[this.pos++] = 0xd2;
+        this.view.setInt32(this.pos, v);
+        this.pos += 4;
+      }
+      return;
+    }
+    // JSON has no NaN or Infinity either; keep them as doubles
+    this.buf[this.pos++] = 0xcb;
+    this.view.setFloat64(this.pos, v);
+    this.pos += 8;
+  }
+
+  object(v) {
+    const keys = Object.keys(v);
+    let count = 0;
+    for (let i = 0; i < keys.length; i++) {
+      const t = typeof v[keys[i]];
+      if (t !== 'undefined' && t !== 'function' && t !== 'symbol') count++;
+    }
+    this.container(0x80, 0xde, count);
+    for (let i = 0; i < keys.length; i++) {
+      const item = v[keys[i]];
+      const t = typeof item;
+      if (t === 'undefined' || t === 'function' || t === 'symbol') continue;
+      this.string(keys[i]);
+      this.value(item);
+    }
+  }
+
+  finish() {
+    const out = this.buf.slice(0, this.pos);
+    this.pos = 0;
+    // Don't pin the memory of one unusually large message
+    if (this.buf.length > 1 << 20) {
+      this.buf = new Uint8Array(1024);
+      this.view = new DataView(this.buf.buffer);
+    }
+    return out;
+  }
+}
+
+const envelopeWriter = new EnvelopeWriter();
+
+// Char code arrays, one per length up to 16, for String.fromCharCode.apply
+const asciiScratch = Array.from({ length: 17 }, (_, n) => new Array(n).fill(0));
+
+// Floats are copied here to be read, so decoding needs no DataView per message
+const floatScratch = new Uint8Array(8);
+const floatView = new DataView(floatScratch.buffer);
+
+class EnvelopeReader {
+  constructor(bytes) {
+    this.bytes = bytes;
+    this.pos = 0;
+  }
+
+  u8() {
+    if (this.pos >= this.bytes.length) throw new RangeError('truncated envelope');
+    return this.bytes[this.pos++];
+  }
+
+  varint() {
+    let v = 0;
+    for (let shift = 0; shift < 35; shift += 7) {
+      const b = this.u8();
+      v += (b & 0x7f) * 2 ** shift;
+      if (b < 0x80) return v;
+    }
+    throw new RangeError('bad varint');
+  }
+
+  // Advance over n bytes and return where they start
+  skip(n) {
+    const at = this.pos;
+    if (at + n > this.bytes.length) throw new RangeError('truncated envelope');
+    this.pos = at + n;
+    return at;
+  }
+
+  take(n) {
+    const at = this.skip(n);
+    return this.bytes.subarray(at, at + n);
+  }
+
+  // Big-endian unsigned integer of 1, 2 or 4 bytes
+  uint(size) {
+    const b = this.bytes;
+    const at = this.skip(size);
+    if (size === 1) return b[at];
+    if (size === 2) return (b[at] << 8) | b[at + 1];
+    return b[at] * 0x1000000 + ((b[at + 1] << 16) | (b[at + 2] << 8) | b[at + 3]);
+  }
+
+  // Big-endian signed integer of 1, 2 or 4 bytes
+  int(size) {
+    const v = this.uint(size);
+    const bits = size * 8;
+    return v >= 2 ** (bits - 1) ? v - 2 ** bits : v;
+  }
+
+  float(size) {
+    const at = this.skip(size);
+    for (let i = 0; i < size; i++) floatScratch[i] = this.bytes[at + i];
+    return size === 4 ? floatView.getFloat32(0) : floatView.getFloat64(0);
+  }
+
+  // Short ASCII strings are built directly; TextDecoder.decode() costs more
+  // than the decoding itself for the keys and names that make up most strings
+  string(n) {
+    const b = this.bytes;
+    const at = this.skip(n);
+    if (n <= 16) {
+      const codes = asciiScratch[n];
+      for (let i = 0; i < n; i++) {
+        const c = b[at + i];
+        if (c >= 0x80) return textDecoder.decode(b.subarray(at, at + n));
+        codes[i] = c;
+      }
+      return String.fromCharCode.apply(null, codes);
+    }
+    return textDecoder.decode(b.subarray(at, at + n));
+  }
+
+  value() {
+    const b = this.u8();
+    if (b < 0x80) return b;
+    if (b >= 0xe0) return b - 0x100;
+    if (b >= 0xa0 && b < 0xc0) return this.string(b & 0x1f);
+    if (b >= 0x90 && b < 0xa0) return this.array(b & 0x0f);
+    if (b < 0x90) return this.map(b & 0x0f);
+    switch (b) {
+      case 0xc0:
+        return null;
+      case 0xc2:
+        return false;
+      case 0xc3:
+        return true;
+      case 0xc4:
+      case 0xc5:
+      case 0xc6:
+        return this.take(this.uint(1 << (b - 0xc4)));
+      case 0xca:
+        return this.float(4);
+      case 0xcb:
+        return this.float(8);
+      case 0xcc:
+      case 0xcd:
+      case 0xce:
+        return this.uint(1 << (b - 0xcc));
+      case 0xcf:
+        return this.uint(4) * 2 ** 32 + this.uint(4);
+      case 0xd0:
+      case 0xd1:
+      case 0xd2:
+        return this.int(1 << (b - 0xd0));
+      case 0xd3:
+        return this.int(4) * 2 ** 32 + this.uint(4);
+      case 0xd9:
+      case 0xda:
+      case 0xdb:
+        return this.string(this.uint(1 << (b - 0xd9)));
+      case 0xdc:
+      case 0xdd:
+        return this.array(this.uint(b === 0xdc ? 2 : 4));
+      case 0xde:
+      case 0xdf:
+        return this.map(this.uint(b === 0xde ? 2 : 4));
+    }
+    throw new RangeError(`unsupported MessagePack type 0x${b.toString(16)}`);
+  }
+
+  array(n) {
+    const out = new Array(n);
+    for (let i = 0; i < n; i++) out[i] = this.value();
+    return out;
+  }
+
+  map(n) {
+    const out = {};
+    for (let i = 0; i < n; i++) {
+      const key = this.value();
+      // An own property, as JSON.parse makes it, rather than the prototype
+      if (key === '__proto__') {
+        Object.defineProperty(out, key, { value: this.value(), enumerable: true, writable: true, configurable: true });
+      } else {
+        out[key] = this.value();
+      }
+    }
+    return out;
+  }
+}
+
+// Decode a binary envelope into the shape of a JSON one ({ t, e, id, args }),
+// recording interned event names in `names`. Returns null if it is malformed
+// or refers to a name this side never saw.
+function decodeBinaryEnvelope(bytes, names) {
+  try {
+    const r = new EnvelopeReader(bytes);
+    r.pos = 1;
+    const typeByte = r.u8();
+    const t = BINARY_TYPE_NAMES[typeByte & ~BINARY_FLAG_NAME];
+    if (!t) return null;
+    const envelope = { t, e: undefined, id: undefined, args: undefined };
+    if (t === ENVELOPE_TYPE_ACK_RESPONSE) {
+      envelope.id = r.varint();
+    } else {
+      const eventId = r.varint();
+      if (typeByte & BINARY_FLAG_NAME) {
+        envelope.e = r.value();
+        if (typeof envelope.e !== 'string') return null;
+        if (eventId) names[eventId] = envelope.e;
+      } else {
+        envelope.e = names[eventId];
+        if (envelope.e === undefined) return null;
+      }
+      if (t === ENVELOPE_TYPE_ACK_REQUEST) envelope.id = r.varint();
+    }
+    envelope.args = r.value();
+    return Array.isArray(envelope.args) ? envelope : null;
+  } catch (_) {
+    return null;
+  }
+}
+
+// Encode a binary envelope for `eventId`, carrying the event name when
+// `withName` is set; ack responses have neither
+function encodeBinaryEnvelope(t, e, eventId, withName, id, args) {
+  const w = envelopeWriter;
+  const type = BINARY_TYPES[t];
+  w.pos = 0;
+  w.u8(BINARY_ENVELOPE_MAGIC);
+  if (t === ENVELOPE_TYPE_ACK_RESPONSE) {
+    w.u8(type);
+    w.varint(id);
+  } else {
+    w.u8(withName ? type | BINARY_FLAG_NAME : type);
+    w.varint(eventId);
+    if (withName) w.string(String(e));
+    if (t === ENVELOPE_TYPE_ACK_REQUEST) w.varint(id);
+  }
+  w.value(args);
+  return w.finish();
+}
+
 function defaultEncode(value) {
   if (value instanceof Uint8Array) return value;
   if (value instanceof ArrayBuffer) return new Uint8Array(value);
-  if (typeof value === 'string') return new TextEncoder().encode(value);
-  return new TextEncoder().encode(JSON.stringify(value));
+  if (typeof value === 'string') return textEncoder.encode(value);
+  return textEncoder.encode(JSON.stringify(value));
+}
+
+// Length-prefixed framing for stream sockets ({ framing: 'length-prefixed' }):
+// each message is a LEB128 varint byte length followed by the payload.
+const DEFAULT_MAX_FRAME_SIZE = 16 * 1024 * 1024;
+// Payloads at least this large get a write of their own (after their frame
+// header, with framing) instead of being copied into a send batch
+const FRAME_COPY_LIMIT = 16 * 1024;
+
+// Stream-mode send queue: a send is written at once when nothing is queued
+// and the writer has room; sends made while the writer is full
+// (writer.desiredSize <= 0) wait in order. With framing they are coalesced
+// into writes of up to SEND_BATCH_LIMIT bytes; without it each read chunk is
+// taken as one message, so every send keeps a write of its own.
+const SEND_BATCH_LIMIT = 64 * 1024;
+const DEFAULT_HIGH_WATER_MARK = 1024 * 1024;
+
+function createSendBatch(bytes) {
+  const batch = {
+    chunks: [bytes],
+    bytes: bytes.length,
+    // Large payloads are written as they are, never joined with others
+    alone: bytes.length >= FRAME_COPY_LIMIT,
+    resolve: null,
+    reject: null,
+    promise: null,
+  };
+  batch.promise = new Promise((resolve, reject) => {
+    batch.resolve = resolve;
+    batch.reject = reject;
+  });
+  // A batch failing is reported through the send() calls awaiting it; one
+  // that nobody awaits (a frame header's) must not be an unhandled rejection
+  batch.promise.catch(() => {});
+  return batch;
+}
+
+function varintSize(n) {
+  let size = 1;
+  while (n >= 0x80) {
+    n = Math.floor(n / 0x80);
+    size++;
+  }
+  return size;
+}
+
+function writeVarint(out, pos, n) {
+  while (n >= 0x80) {
+    out[pos++] = (n & 0x7f) | 0x80;
+    n = Math.floor(n / 0x80);
+  }
+  out[pos++] = n;
+  return pos;
+}
+
+class FrameError extends RangeError {}
+
+// Splits a byte stream back into frames. A frame that lies within one read
+// chunk is handed out as a subarray of it; only a frame that spans chunks is
+// copied, into a buffer allocated at its exact size once its header is
+// complete. The header itself may also be split across chunks.
+class FrameDecoder {
+  constructor(maxFrameSize = DEFAULT_MAX_FRAME_SIZE) {
+    this.maxFrameSize = maxFrameSize;
+    this.frame = null;
+    this.filled = 0;
+    this.length = 0;
+    this.shift = 0;
+  }
+
+  // Call onFrame for every frame completed by chunk. Throws a FrameError for
+  // a frame over maxFrameSize or a malformed header.
+  push(chunk, onFrame) {
+    let pos = 0;
+    while (pos < chunk.length) {
+      if (this.frame) {
+        const n = Math.min(this.frame.length - this.filled, chunk.length - pos);
+        this.frame.set(chunk.subarray(pos, pos + n), this.filled);
+        this.filled += n;
+        pos += n;
+        if (this.filled === this.frame.length) {
+          const frame = this.frame;
+          this.frame = null;
+          onFrame(frame);
+        }
+        continue;
+      }
+
+      const b = chunk[pos++];
+      this.length += (b & 0x7f) * 2 ** this.shift;
+      this.shift += 7;
+      if (b & 0x80) {
+        if (this.shift >= 35) throw new FrameError('Malformed frame length');
+        continue;
+      }
+      const length = this.length;
+      this.length = 0;
+      this.shift = 0;
+      if (length > this.maxFrameSize) {
+        throw new FrameError(`Frame of ${length} bytes exceeds maxFrameSize (${this.maxFrameSize})`);
+      }
+      if (pos + length <= chunk.length) {
+        onFrame(chunk.subarray(pos, pos + length));
+        pos += length;
+      } else {
+        this.frame = new Uint8Array(length);
+        this.filled = 0;
+      }
+    }
+  }
 }
 
 function defaultDecode(value, binaryType) {
@@ -108,6 +657,100 @@ function parseUdpSendArgs(data, args) {
   return { payload, target: undefined };
 }
 
+// emitWithAck() deadlines live in one timer wheel shared by all connections,
+// advanced by a single interval that runs only while acks are pending. Each
+// PendingAck is a node in its slot's doubly linked list, so adding and
+// cancelling are O(1). A timeout fires up to ACK_WHEEL_TICK_MS late, never
+// early; deadlines more than one revolution out wait in their slot until the
+// tick they are due.
+const ACK_WHEEL_TICK_MS = 50;
+const ACK_WHEEL_SLOTS = 256;
+
+class PendingAck {
+  constructor(acks, id, eventName, resolve, reject) {
+    this.acks = acks;
+    this.id = id;
+    this.eventName = eventName;
+    this.resolve = resolve;
+    this.reject = reject;
+    this.dueTick = 0;
+    this.slot = -1;
+    this.prev = null;
+    this.next = null;
+  }
+
+  expire() {
+    this.acks.delete(this.id);
+    this.reject(new Error(`Ack timeout for event '${this.eventName}'`));
+  }
+}
+
+class AckTimerWheel {
+  constructor() {
+    this.slots = new Array(ACK_WHEEL_SLOTS).fill(null);
+    this.size = 0;
+    // Ticks since the interval started, and when the current one began
+    this.tick = 0;
+    this.tickTime = 0;
+    this.interval = null;
+  }
+
+  add(entry, delayMs) {
+    const now = performance.now();
+    if (!this.interval) {
+      this.tickTime = now;
+      this.interval = setInterval(() => this.advance(), ACK_WHEEL_TICK_MS);
+    }
+    entry.dueTick = this.tick + Math.max(1, Math.ceil((now + delayMs - this.tickTime) / ACK_WHEEL_TICK_MS));
+    const slot = entry.dueTick % ACK_WHEEL_SLOTS;
+    entry.slot = slot;
+    entry.prev = null;
+    entry.next = this.slots[slot];
+    if (entry.next) entry.next.prev = entry;
+    this.slots[slot] = entry;
+    this.size++;
+  }
+
+  cancel(entry) {
+    if (entry.slot < 0) return;
+    if (entry.prev) entry.prev.next = entry.next;
+    else this.slots[entry.slot] = entry.next;
+    if (entry.next) entry.next.prev = entry.prev;
+    entry.slot = -1;
+    entry.prev = entry.next = null;
+    this.size--;
+  }
+
+  advance() {
+    const elapsed = Math.floor((performance.now() - this.tickTime) / ACK_WHEEL_TICK_MS);
+    if (elapsed > 0) {
+      const target = this.tick + elapsed;
+      // A throttled interval may have missed ticks; after a stall of a whole
+      // revolution or more, every slot is visited once
+      const last = Math.min(target, this.tick + ACK_WHEEL_SLOTS);
+      for (let tick = this.tick + 1; tick <= last; tick++) {
+        let entry = this.slots[tick % ACK_WHEEL_SLOTS];
+        while (entry) {
+          const next = entry.next;
+          if (entry.dueTick <= target) {
+            this.cancel(entry);
+            entry.expire();
+          }
+          entry = next;
+        }
+      }
+      this.tick = target;
+      this.tickTime += elapsed * ACK_WHEEL_TICK_MS;
+    }
+    if (this.size === 0) {
+      clearInterval(this.interval);
+      this.interval = null;
+    }
+  }
+}
+
+const ackTimers = new AckTimerWheel();
+
 class Emitter {
   constructor() {
     this.listeners = new Map();
@@ -152,8 +795,30 @@ export class DirectSocketConnection extends Emitter {
     this.mode = mode;
     this.readyState = OPEN;
     this.binaryType = 'arraybuffer';
+    // 'binary' (default) or 'json' envelopes for emit()/emitWithAck(); both
+    // are understood on receive, so 'json' is only needed by older peers
+    this.envelope = options.envelope === 'json' ? 'json' : 'binary';
     this._ackSeq = 1;
     this._pendingAcks = new Map();
+    // Interned event names: sent name -> id, received id -> name
+    this._eventIds = new Map();
+    this._eventNames = [];
+    // Stream sockets only: with framing, one message per length-prefixed
+    // frame rather than one per read
+    this.framing = mode === 'stream' && options.framing === 'length-prefixed' ? options.framing : null;
+    this.maxFrameSize = options.maxFrameSize || DEFAULT_MAX_FRAME_SIZE;
+    this._frames = this.framing ? new FrameDecoder(this.maxFrameSize) : null;
+    // Bytes accepted by send() and room broadcasts that the writer has not
+    // finished writing (bufferedAmount). Reaching highWaterMark arms 'drain',
+    // emitted once it falls back to lowWaterMark.
+    this._queuedBytes = 0;
+    this.highWaterMark = options.highWaterMark || DEFAULT_HIGH_WATER_MARK;
+    this.lowWaterMark = options.lowWaterMark ?? this.highWaterMark / 4;
+    this._needDrain = false;
+    // Stream mode: batches not yet handed to the writer, oldest first
+    this._batches = [];
+    this._flushScheduled = false;
+    this._waitingForWriter = false;
     this._reader = opened.readable.getReader();
     this._writer = opened.writable.getWriter();
     this._multicastOptions = {
@@ -187,19 +852,19 @@ export class DirectSocketConnection extends Emitter {
         const { value, done } = await this._reader.read();
         if (done) break;
 
-        const message = this._normalizeIncoming(value);
-        if (this.mode === 'datagram') {
-          const rinfo = {
-            address: message.remoteAddress,
-            port: message.remotePort,
-            size: message.byteLength,
-          };
-          super.emit('message', message.data, rinfo);
-        } else {
-          super.emit('message', message.data);
+        if (!this._frames) {
+          this._deliver(value);
+          continue;
+        }
+        try {
+          this._frames.push(value, (frame) => this._deliver(frame));
+        } catch (err) {
+          // Oversized or corrupt frame: the stream can't be resynchronized
+          if (!(err instanceof FrameError)) throw err;
+          super.emit('error', err);
+          await this.close(1009, 'message too big');
+          return;
         }
-
-        this._handleStructuredMessage(message.data);
       }
     } catch (err) {
       super.emit('error', err);
@@ -208,6 +873,24 @@ export class DirectSocketConnection extends Emitter {
     }
   }
 
+  // One incoming message: a datagram, a read chunk, or a frame
+  _deliver(value) {
+    const raw = this.mode === 'datagram' ? value?.data ?? value : value;
+    const message = this._normalizeIncoming(value);
+    if (this.mode === 'datagram') {
+      const rinfo = {
+        address: message.remoteAddress,
+        port: message.remotePort,
+        size: message.byteLength,
+      };
+      super.emit('message', message.data, rinfo);
+    } else {
+      super.emit('message', message.data);
+    }
+
+    this._handleStructuredMessage(raw);
+  }
+
   _normalizeIncoming(value) {
     if (this.mode === 'datagram') {
       const data = value?.data ?? value;
@@ -224,18 +907,25 @@ export class DirectSocketConnection extends Emitter {
     return { data: defaultDecode(value, this.binaryType) };
   }
 
+  // Dispatch an envelope received as `payload`, the bytes as read from the
+  // socket. The first byte decides: binary envelopes are decoded in place,
+  // anything starting with '{' is tried as a JSON envelope, and other data is
+  // left alone without being decoded.
   _handleStructuredMessage(payload) {
-    let asString = null;
+    let envelope = null;
+    let binary = false;
 
     if (typeof payload === 'string') {
-      asString = payload;
-    } else if (payload instanceof ArrayBuffer) {
-      asString = new TextDecoder().decode(new Uint8Array(payload));
-    } else if (payload instanceof Uint8Array) {
-      asString = new TextDecoder().decode(payload);
+      if (payload.charCodeAt(0) === JSON_ENVELOPE_START) envelope = maybeParseEnvelope(payload);
+    } else if (payload instanceof Uint8Array || payload instanceof ArrayBuffer) {
+      const bytes = payload instanceof Uint8Array ? payload : new Uint8Array(payload);
+      if (bytes[0] === BINARY_ENVELOPE_MAGIC) {
+        envelope = decodeBinaryEnvelope(bytes, this._eventNames);
+        binary = true;
+      } else if (bytes[0] === JSON_ENVELOPE_START) {
+        envelope = maybeParseEnvelope(textDecoder.decode(bytes));
+      }
     }
-
-    const envelope = maybeParseEnvelope(asString);
     if (!envelope) return;
 
     if (envelope.t === ENVELOPE_TYPE_EVENT) {
@@ -244,55 +934,224 @@ export class DirectSocketConnection extends Emitter {
     }
 
     if (envelope.t === ENVELOPE_TYPE_ACK_REQUEST) {
+      // Answer in the format the request came in
       const respond = async (...args) => {
-        await this._sendEnvelope({
-          __socketiwa: 1,
-          t: ENVELOPE_TYPE_ACK_RESPONSE,
-          id: envelope.id,
-          args,
-        });
+        await this._sendEnvelope({ t: ENVELOPE_TYPE_ACK_RESPONSE, id: envelope.id, args }, undefined, binary);
       };
       super.emit(envelope.e, ...(envelope.args || []), respond);
       return;
     }
 
-    if (envelope.t === ENVELOPE_TYPE_ACK_RESPONSE && this._pendingAcks.has(envelope.id)) {
+    if (envelope.t === ENVELOPE_TYPE_ACK_RESPONSE) {
       const pending = this._pendingAcks.get(envelope.id);
-      clearTimeout(pending.timeout);
+      if (!pending) return;
       this._pendingAcks.delete(envelope.id);
+      ackTimers.cancel(pending);
       pending.resolve((envelope.args || [])[0]);
     }
   }
 
-  async _sendEnvelope(envelope, target) {
-    return this.send(JSON.stringify(envelope), target);
+  async _sendEnvelope(envelope, target, binary = this.envelope === 'binary') {
+    if (!binary) return this.send(JSON.stringify({ __socketiwa: 1, ...envelope }), target);
+    return this.send(this._encodeEnvelope(envelope), target);
+  }
+
+  _encodeEnvelope({ t, e, id, args }) {
+    let eventId = 0;
+    let fresh = false;
+    if (t !== ENVELOPE_TYPE_ACK_RESPONSE && this.framing) {
+      eventId = this._eventIds.get(e);
+      if (eventId === undefined) {
+        eventId = this._eventIds.size + 1;
+        fresh = true;
+      }
+    }
+    const bytes = encodeBinaryEnvelope(t, e, eventId, fresh || eventId === 0, id, args);
+    // Only once the envelope carrying the name is certain to be sent
+    if (fresh) this._eventIds.set(e, eventId);
+    return bytes;
+  }
+
+  // Bytes as they go on the wire for this connection's envelope format and
+  // framing, for an event that is not interned (id 0 with the name inline),
+  // so they are the same for every connection with the same format. Used by
+  // room broadcasts to encode once per format.
+  _encodeBroadcast(eventName, args) {
+    const payload =
+      this.envelope === 'json'
+        ? textEncoder.encode(JSON.stringify({ __socketiwa: 1, t: ENVELOPE_TYPE_EVENT, e: eventName, args }))
+        : encodeBinaryEnvelope(ENVELOPE_TYPE_EVENT, eventName, 0, true, undefined, args);
+    return this._frameBytes(payload);
+  }
+
+  // payload with the framing header in front, if this connection frames
+  _frameBytes(payload) {
+    if (!this.framing) return payload;
+    const frame = new Uint8Array(varintSize(payload.length) + payload.length);
+    frame.set(payload, writeVarint(frame, 0, payload.length));
+    return frame;
+  }
+
+  get bufferedAmount() {
+    return this._queuedBytes;
+  }
+
+  // Queue bytes without waiting for them to be written; a failed write is
+  // reported as 'error' and closes the connection
+  _queueWrite(bytes) {
+    this._enqueue(bytes).catch((err) => {
+      if (this.readyState !== OPEN) return;
+      super.emit('error', err);
+      this.close(1006, 'write failed').catch(() => {});
+    });
+  }
+
+  // Append bytes to the send queue. Resolves once the write carrying them
+  // completes. Queued bytes join the last batch when framed, or start their
+  // own; batches are flushed at the end of the microtask or, if the writer
+  // is full, on writer.ready.
+  _enqueue(bytes) {
+    this._queuedBytes += bytes.length;
+    if (this._queuedBytes >= this.highWaterMark) this._needDrain = true;
+    if (!this._batches.length && !this._waitingForWriter && this._writer.desiredSize > 0) {
+      const written = this._writer.write(bytes);
+      const n = bytes.length;
+      written.then(
+        () => this._written(n),
+        () => this._written(n),
+      );
+      return written;
+    }
+    const last = this._batches[this._batches.length - 1];
+    let batch;
+    if (
+      this.framing &&
+      last &&
+      !last.alone &&
+      bytes.length < FRAME_COPY_LIMIT &&
+      last.bytes + bytes.length <= SEND_BATCH_LIMIT
+    ) {
+      batch = last;
+      batch.chunks.push(bytes);
+      batch.bytes += bytes.length;
+    } else {
+      batch = createSendBatch(bytes);
+      this._batches.push(batch);
+    }
+    if (!this._flushScheduled && !this._waitingForWriter) {
+      this._flushScheduled = true;
+      queueMicrotask(() => this._flushSends(false));
+    }
+    return batch.promise;
+  }
+
+  // Hand queued batches to the writer while it has room, then wait for
+  // writer.ready. After ready one batch is written regardless, so a writer
+  // that never asks for more still fails the pending sends.
+  _flushSends(afterReady) {
+    this._flushScheduled = false;
+    if (this._waitingForWriter) return;
+    if (this.readyState === CLOSED) {
+      this._failSends(new Error('Socket is not open'));
+      return;
+    }
+    if (afterReady && this._batches.length) this._writeBatch(this._batches.shift());
+    while (this._batches.length && this._writer.desiredSize > 0) this._writeBatch(this._batches.shift());
+    if (!this._batches.length) return;
+    this._waitingForWriter = true;
+    this._writer.ready.then(
+      () => {
+        this._waitingForWriter = false;
+        this._flushSends(true);
+      },
+      (err) => {
+        this._waitingForWriter = false;
+        this._failSends(err);
+      },
+    );
+  }
+
+  _writeBatch(batch) {
+    const { chunks } = batch;
+    let bytes = chunks[0];
+    if (chunks.length > 1) {
+      bytes = new Uint8Array(batch.bytes);
+      let pos = 0;
+      for (const chunk of chunks) {
+        bytes.set(chunk, pos);
+        pos += chunk.length;
+      }
+    }
+    this._writer.write(bytes).then(
+      () => {
+        this._written(batch.bytes);
+        batch.resolve();
+      },
+      (err) => {
+        this._written(batch.bytes);
+        batch.reject(err);
+      },
+    );
+  }
+
+  _failSends(err) {
+    for (const batch of this._batches.splice(0)) {
+      this._written(batch.bytes);
+      batch.reject(err);
+    }
+  }
+
+  // `n` queued bytes have left the queue, written or not
+  _written(n) {
+    this._queuedBytes -= n;
+    if (this._needDrain && this._queuedBytes <= this.lowWaterMark) {
+      this._needDrain = false;
+      super.emit('drain');
+    }
   }
 
   async send(data, ...args) {
     if (this.readyState !== OPEN) throw new Error('Socket is not open');
 
     if (this.mode === 'datagram') {
+      // Datagrams keep their boundaries, so each is its own write
       const parsed = parseUdpSendArgs(data, args);
       const payload = defaultEncode(parsed.payload);
-
-      if (parsed.target?.remoteAddress && parsed.target?.remotePort) {
-        await this._writer.write({
-          data: payload,
-          remoteAddress: parsed.target.remoteAddress,
-          remotePort: parsed.target.remotePort,
-        });
-        return;
+      const datagram = parsed.target?.remoteAddress && parsed.target?.remotePort
+        ? { data: payload, remoteAddress: parsed.target.remoteAddress, remotePort: parsed.target.remotePort }
+        : { data: payload };
+      this._queuedBytes += payload.length;
+      if (this._queuedBytes >= this.highWaterMark) this._needDrain = true;
+      try {
+        await this._writer.write(datagram);
+      } finally {
+        this._written(payload.length);
       }
-
-      await this._writer.write({ data: payload });
       return;
     }
 
-    await this._writer.write(defaultEncode(data));
+    const payload = defaultEncode(data);
+    if (!this.framing) {
+      await this._enqueue(payload);
+      return;
+    }
+    if (payload.length > this.maxFrameSize) {
+      throw new RangeError(`Message of ${payload.length} bytes exceeds maxFrameSize (${this.maxFrameSize})`);
+    }
+    if (payload.length < FRAME_COPY_LIMIT) {
+      await this._enqueue(this._frameBytes(payload));
+      return;
+    }
+    // Header and payload are queued together, so no other send can land
+    // between them
+    const header = new Uint8Array(varintSize(payload.length));
+    writeVarint(header, 0, payload.length);
+    this._enqueue(header);
+    await this._enqueue(payload);
   }
 
   async emitEvent(eventName, ...args) {
-    await this._sendEnvelope({ __socketiwa: 1, t: ENVELOPE_TYPE_EVENT, e: eventName, args });
+    await this._sendEnvelope({ t: ENVELOPE_TYPE_EVENT, e: eventName, args });
   }
 
   async emit(eventName, ...args) {
@@ -307,39 +1166,44 @@ export class DirectSocketConnection extends Emitter {
     if (this.readyState !== OPEN) throw new Error('Socket is not open');
 
     const id = this._ackSeq++;
-    return new Promise(async (resolve, reject) => {
-      const timeout = setTimeout(() => {
-        this._pendingAcks.delete(id);
-        reject(new Error(`Ack timeout for event '${eventName}'`));
-      }, timeoutMs);
-
-      this._pendingAcks.set(id, { resolve, reject, timeout });
-      try {
-        await this._sendEnvelope({
-          __socketiwa: 1,
-          t: ENVELOPE_TYPE_ACK_REQUEST,
-          e: eventName,
-          args: [payload],
-          id,
-        });
-      } catch (err) {
-        clearTimeout(timeout);
-        this._pendingAcks.delete(id);
-        reject(err);
-      }
+    let pending;
+    const reply = new Promise((resolve, reject) => {
+      pending = new PendingAck(this._pendingAcks, id, eventName, resolve, reject);
+    });
+    this._pendingAcks.set(id, pending);
+    // A non-finite timeout waits for the reply indefinitely
+    if (Number.isFinite(timeoutMs)) ackTimers.add(pending, timeoutMs);
+    this._sendEnvelope({ t: ENVELOPE_TYPE_ACK_REQUEST, e: eventName, args: [payload], id }).catch((err) => {
+      if (!this._pendingAcks.delete(id)) return;
+      ackTimers.cancel(pending);
+      pending.reject(err);
     });
+    return reply;
   }
 
   async close(code = 1000, reason = 'normal closure') {
     if (this.readyState >= CLOSING) return;
     this.readyState = CLOSING;
+    // Whatever is still queued goes to the writer ahead of the close
+    while (this._batches.length) this._writeBatch(this._batches.shift());
     await this.socket.close?.(code, reason);
     this._finalizeClose(code, reason);
   }
 
+  // Acks still outstanding at close will never be answered
+  _failAcks(err) {
+    for (const pending of this._pendingAcks.values()) {
+      ackTimers.cancel(pending);
+      pending.reject(err);
+    }
+    this._pendingAcks.clear();
+  }
+
   _finalizeClose(code = 1000, reason = 'closed') {
     if (this.readyState === CLOSED) return;
     this.readyState = CLOSED;
+    this._failSends(new Error('Socket is not open'));
+    this._failAcks(new Error('Socket is not open'));
     super.emit('close', { code, reason });
     super.emit('disconnect', { code, reason });
   }
@@ -431,10 +1295,17 @@ function createMulticastFacade(connection, udpOpenInfo) {
 }
 
 export class DirectSocketServer extends Emitter {
-  constructor({ socket, opened }) {
+  constructor({ socket, opened, options = {} }) {
     super();
     this.socket = socket;
     this.opened = opened;
+    this.options = options;
+    // Room broadcasts queue to each member without waiting for its writes.
+    // A member with more than maxQueuedBytes still unwritten is a slow
+    // consumer: 'drop' skips it for that message, 'disconnect' closes it
+    // (code 1008), 'buffer' queues regardless.
+    this.maxQueuedBytes = options.maxQueuedBytes ?? 1024 * 1024;
+    this.slowConsumer = options.slowConsumer || 'buffer';
     this.readyState = OPEN;
     this.binaryType = 'arraybuffer';
     this._rooms = new Map();
@@ -461,7 +1332,13 @@ export class DirectSocketServer extends Emitter {
         if (done || !value) break;
 
         const openInfo = await value.opened;
-        const conn = new DirectSocketConnection({ kind: 'tcp', socket: value, opened: openInfo, mode: 'stream' });
+        const conn = new DirectSocketConnection({
+          kind: 'tcp',
+          socket: value,
+          opened: openInfo,
+          mode: 'stream',
+          options: this.options,
+        });
         conn.binaryType = this.binaryType;
 
         conn.join = (roomName) => this._joinRoom(roomName, conn);
@@ -490,18 +1367,44 @@ export class DirectSocketServer extends Emitter {
     return conn;
   }
 
+  // Broadcast to a room. The message is encoded once per wire format in use
+  // (envelope format x framing) and the same buffer is queued to every
+  // member, so a broadcast costs one encode and no waiting on any member.
+  // Resolves to { delivered, dropped, disconnected } once it is queued.
   to(roomName) {
     const room = this._rooms.get(roomName) || new Set();
     return {
-      emit: async (eventName, ...args) => {
-        await Promise.all([...room].map((conn) => conn.emitEvent(eventName, ...args)));
-      },
+      emit: async (eventName, ...args) => this._broadcast(room, (conn) => conn._encodeBroadcast(eventName, args)),
       send: async (data) => {
-        await Promise.all([...room].map((conn) => conn.send(data)));
+        const payload = defaultEncode(data);
+        return this._broadcast(room, (conn) => conn._frameBytes(payload));
       },
     };
   }
 
+  _broadcast(room, encode) {
+    const result = { delivered: 0, dropped: 0, disconnected: 0 };
+    // Index: bit 0 JSON envelopes, bit 1 framing
+    const encoded = [null, null, null, null];
+    for (const conn of room) {
+      if (conn.readyState !== OPEN) continue;
+      const format = (conn.envelope === 'json' ? 1 : 0) | (conn.framing ? 2 : 0);
+      const bytes = encoded[format] || (encoded[format] = encode(conn));
+      if (conn._queuedBytes > 0 && conn._queuedBytes + bytes.length > this.maxQueuedBytes && this.slowConsumer !== 'buffer') {
+        if (this.slowConsumer === 'disconnect') {
+          conn.close(1008, 'slow consumer').catch(() => {});
+          result.disconnected++;
+        } else {
+          result.dropped++;
+        }
+        continue;
+      }
+      conn._queueWrite(bytes);
+      result.delivered++;
+    }
+    return result;
+  }
+
   async close(code = 1000, reason = 'server closed') {
     if (this.readyState >= CLOSING) return;
     this.readyState = CLOSING;
@@ -545,7 +1448,7 @@ export class SocketIWA {
 
     const socket = new TCPSocket(remoteAddress, remotePort, options);
     const opened = await socket.opened;
-    return new DirectSocketConnection({ kind: 'tcp', socket, opened, mode: 'stream' });
+    return new DirectSocketConnection({ kind: 'tcp', socket, opened, mode: 'stream', options });
   }
 
   static async createUDP(options = {}) {
@@ -592,13 +1495,27 @@ export class SocketIWA {
     return SocketIWA.createUDP(udpOptions);
   }
 
-  static async createTCPServer(localAddress, { localPort, backlog } = {}) {
+  static async createTCPServer(
+    localAddress,
+    {
+      localPort,
+      backlog,
+      envelope,
+      framing,
+      maxFrameSize,
+      maxQueuedBytes,
+      slowConsumer,
+      highWaterMark,
+      lowWaterMark,
+    } = {},
+  ) {
     SocketIWA.assertPermissions();
     ensureSupported('TCPServerSocket', globalThis.TCPServerSocket);
 
     const socket = new TCPServerSocket(localAddress, { localPort, backlog });
     const opened = await socket.opened;
-    return new DirectSocketServer({ socket, opened });
+    const options = { envelope, framing, maxFrameSize, maxQueuedBytes, slowConsumer, highWaterMark, lowWaterMark };
+    return new DirectSocketServer({ socket, opened, options });
   }
 
   static createMulticastController(udpOpenInfo) {
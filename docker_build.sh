@@ -55,9 +55,11 @@ print('Patched libwasi.js')
 "
 fi
 
-# 4. Copy our new library file
+# 4. Copy our new library file and the stats header
 cp "$SRCDIR/emscripten/src/lib/libdirectsockets.js" "$EMDIR/src/lib/libdirectsockets.js"
 echo "Copied libdirectsockets.js"
+cp "$SRCDIR/emscripten/system/include/emscripten/direct_sockets_stats.h" "$EMDIR/system/include/emscripten/direct_sockets_stats.h"
+echo "Copied direct_sockets_stats.h"
 
 # 5. Register libdirectsockets.js in modules.mjs so the JS compiler loads it
 if ! grep -q 'libdirectsockets' "$EMDIR/src/modules.mjs"; then
@@ -190,13 +192,17 @@ new_ds_close = '''#elif DIRECT_SOCKETS
     if (typeof DIRECT_SOCKETS_PIPES !== 'undefined' && DIRECT_SOCKETS_PIPES.closePipeFd(fd)) {
       return 0;
     }
+    if (typeof DIRECT_SOCKETS_EPOLL !== 'undefined' && DIRECT_SOCKETS_EPOLL.close(fd)) {
+      FS.close(FS.getStream(fd));
+      return 0;
+    }
     return 0;'''
 
 if old_ds_close in content:
     content = content.replace(old_ds_close, new_ds_close)
     with open(path, 'w') as f:
         f.write(content)
-    print('Patched libwasi.js (added pipe fd cleanup)')
+    print('Patched libwasi.js (added pipe/epoll fd cleanup)')
 else:
     print('libwasi.js: DIRECT_SOCKETS_PIPES patch not needed or already applied')
 "
@@ -205,90 +211,75 @@ fi
 # 6c. Patch fd_read and fd_write in libwasi.js to handle pipe/socketpair fds
 # read()/write() on pipe fds go through WASI fd_read/fd_write, not socket syscalls.
 # The WASI function signatures vary by emscripten version, so we extract param names dynamically.
-if ! grep -q 'DIRECT_SOCKETS_PIPES.*readPipe' "$EMDIR/src/lib/libwasi.js"; then
+# DIRECT_SOCKETS_PIPES.fdRead/fdWrite return a WASI errno, or a Promise of one
+# when a blocking pipe has to wait, so both imports are marked __async for JSPI.
+if ! grep -q 'DIRECT_SOCKETS_PIPES.fdRead' "$EMDIR/src/lib/libwasi.js"; then
 python3 -c "
 import re
 path = '$EMDIR/src/lib/libwasi.js'
 with open(path) as f:
     content = f.read()
 
-# Patch fd_read: extract actual parameter names and inject pipe check
-fd_read_pattern = r'(fd_read\s*:\s*(?:async\s+)?function\s*\(([^)]*)\)\s*\{)'
-m = re.search(fd_read_pattern, content)
-if m:
-    inject_after = m.group(0)
-    params = [p.strip() for p in m.group(2).split(',')]
+def patch(name, helper):
+    global content
+    # Matches both 'fd_read: function(fd, iov, ...) {' and 'fd_read: (fd, iov, ...) => {'
+    pattern = r'(\n([ \t]*)' + name + r'\s*:\s*(?:async\s+)?(?:function\s*)?\(([^)]*)\)\s*(?:=>\s*)?\{)'
+    m = re.search(pattern, content)
+    if not m:
+        print('WARNING: Could not find ' + name + ' function in libwasi.js')
+        return
+    ind = m.group(2)
     # params should be like [fd, iov, iovcnt, pnum] but names vary
-    p_fd = params[0] if len(params) > 0 else 'fd'
-    p_iov = params[1] if len(params) > 1 else 'iov'
-    p_iovcnt = params[2] if len(params) > 2 else 'iovcnt'
-    p_pnum = params[3] if len(params) > 3 else 'pnum'
-
-    pipe_read_check = '''
-#if DIRECT_SOCKETS
-    if (typeof DIRECT_SOCKETS_PIPES !== 'undefined') {
-      var __pipeEntry = DIRECT_SOCKETS_PIPES.getPipe(''' + p_fd + ''');
-      if (__pipeEntry) {
-        var __totalRead = 0;
-        for (var __pi = 0; __pi < ''' + p_iovcnt + '''; __pi++) {
-          var __ptr = {{{ makeGetValue(\"''' + p_iov + '''\", '__pi * 8', POINTER_TYPE) }}};
-          var __len = {{{ makeGetValue(\"''' + p_iov + '''\", '__pi * 8 + 4', POINTER_TYPE) }}};
-          var __chunk = DIRECT_SOCKETS_PIPES.readPipe(''' + p_fd + ''', __len);
-          if (__chunk && __chunk.length > 0) {
-            HEAPU8.set(__chunk, __ptr);
-            __totalRead += __chunk.length;
-          }
-        }
-        {{{ makeSetValue(\"''' + p_pnum + '''\", 0, '__totalRead', POINTER_TYPE) }}};
-        return 0;
-      }
-    }
-#endif
-'''
-    content = content.replace(inject_after, inject_after + pipe_read_check, 1)
-    print('Patched fd_read for pipe support (params: ' + ', '.join(params) + ')')
-else:
-    print('WARNING: Could not find fd_read function in libwasi.js')
+    params = [p.strip() for p in m.group(3).split(',')]
+    params += ['fd', 'iov', 'iovcnt', 'pnum'][len(params):]
+    hook = ('\n#if DIRECT_SOCKETS\n'
+            + ind + '  if (typeof DIRECT_SOCKETS_PIPES !== \'undefined\' && DIRECT_SOCKETS_PIPES.getPipe(' + params[0] + ')) {\n'
+            + ind + '    return DIRECT_SOCKETS_PIPES.' + helper + '(' + ', '.join(params[:4]) + ');\n'
+            + ind + '  }\n'
+            + '#endif\n')
+    async_flag = '\n#if DIRECT_SOCKETS && JSPI\n' + ind + name + '__async: true,\n#endif'
+    content = content[:m.start()] + async_flag + m.group(1) + hook + content[m.end():]
+    print('Patched ' + name + ' for pipe support (params: ' + ', '.join(params) + ')')
+
+patch('fd_read', 'fdRead')
+patch('fd_write', 'fdWrite')
 
-# Patch fd_write: extract actual parameter names and inject pipe check
-fd_write_pattern = r'(fd_write\s*:\s*(?:async\s+)?function\s*\(([^)]*)\)\s*\{)'
-m = re.search(fd_write_pattern, content)
-if m:
-    inject_after = m.group(0)
-    params = [p.strip() for p in m.group(2).split(',')]
-    p_fd = params[0] if len(params) > 0 else 'fd'
-    p_iov = params[1] if len(params) > 1 else 'iov'
-    p_iovcnt = params[2] if len(params) > 2 else 'iovcnt'
-    p_pnum = params[3] if len(params) > 3 else 'pnum'
-
-    pipe_write_check = '''
-#if DIRECT_SOCKETS
-    if (typeof DIRECT_SOCKETS_PIPES !== 'undefined') {
-      var __pipeEntry = DIRECT_SOCKETS_PIPES.getPipe(''' + p_fd + ''');
-      if (__pipeEntry) {
-        var __totalWritten = 0;
-        for (var __pi = 0; __pi < ''' + p_iovcnt + '''; __pi++) {
-          var __ptr = {{{ makeGetValue(\"''' + p_iov + '''\", '__pi * 8', POINTER_TYPE) }}};
-          var __len = {{{ makeGetValue(\"''' + p_iov + '''\", '__pi * 8 + 4', POINTER_TYPE) }}};
-          var __data = HEAPU8.slice(__ptr, __ptr + __len);
-          var __rc = DIRECT_SOCKETS_PIPES.writePipe(''' + p_fd + ''', __data);
-          if (__rc < 0) {
-            if (__totalWritten > 0) break;
-            {{{ makeSetValue(\"''' + p_pnum + '''\", 0, '0', POINTER_TYPE) }}};
-            return 29; /* __WASI_ERRNO_PIPE */
-          }
-          __totalWritten += __rc;
-        }
-        {{{ makeSetValue(\"''' + p_pnum + '''\", 0, '__totalWritten', POINTER_TYPE) }}};
-        return 0;
-      }
-    }
-#endif
-'''
-    content = content.replace(inject_after, inject_after + pipe_write_check, 1)
-    print('Patched fd_write for pipe support (params: ' + ', '.join(params) + ')')
-else:
-    print('WARNING: Could not find fd_write function in libwasi.js')
+with open(path, 'w') as f:
+    f.write(content)
+"
+fi
+
+# 6c'. Socket fds in fd_read/fd_write go to DIRECT_SOCKETS.fdRead/fdWrite,
+# which gather a writev() into one writer.write() and scatter a readv()
+# from the receive queue in one pass, instead of FS calling stream_ops once
+# per iovec. Applied separately so trees patched by 6c alone pick it up.
+if ! grep -q 'DIRECT_SOCKETS.fdRead' "$EMDIR/src/lib/libwasi.js"; then
+python3 -c "
+import re
+path = '$EMDIR/src/lib/libwasi.js'
+with open(path) as f:
+    content = f.read()
+
+def patch(name, helper):
+    global content
+    pattern = r'(\n([ \t]*)' + name + r'\s*:\s*(?:async\s+)?(?:function\s*)?\(([^)]*)\)\s*(?:=>\s*)?\{)'
+    m = re.search(pattern, content)
+    if not m:
+        print('WARNING: Could not find ' + name + ' function in libwasi.js')
+        return
+    ind = m.group(2)
+    params = [p.strip() for p in m.group(3).split(',')]
+    params += ['fd', 'iov', 'iovcnt', 'pnum'][len(params):]
+    hook = ('\n#if DIRECT_SOCKETS\n'
+            + ind + '  if (typeof DIRECT_SOCKETS !== \'undefined\' && DIRECT_SOCKETS.getSocket(' + params[0] + ')) {\n'
+            + ind + '    return DIRECT_SOCKETS.' + helper + '(' + ', '.join(params[:4]) + ');\n'
+            + ind + '  }\n'
+            + '#endif\n')
+    content = content[:m.end()] + hook + content[m.end():]
+    print('Patched ' + name + ' for vectored socket I/O')
+
+patch('fd_read', 'fdRead')
+patch('fd_write', 'fdWrite')
 
 with open(path, 'w') as f:
     f.write(content)
@@ -375,6 +366,64 @@ else:
   fi
 done
 
+# 6e. Patch musl's __lookup_name so getaddrinfo sees every A/AAAA record.
+# _emscripten_lookup_name only returns one packed IPv4 address; our
+# _emscripten_lookup_name_all fills musl's struct address array directly.
+# Its results are already ordered (IPv6/IPv4 interleaved), so musl's RFC 3484
+# sort is skipped - it would open UDP sockets to probe routes.
+LOOKUPNAME="$EMDIR/system/lib/libc/musl/src/network/lookup_name.c"
+if [ -f "$LOOKUPNAME" ] && ! grep -q '_emscripten_lookup_name_all' "$LOOKUPNAME" 2>/dev/null; then
+python3 -c "
+import re
+path = '$LOOKUPNAME'
+with open(path) as f:
+    content = f.read()
+
+proto = 'int _emscripten_lookup_name_all(const char *name, int family, struct address *buf, int max);\n'
+content = content.replace('#include \"lookup.h\"\n', '#include \"lookup.h\"\n' + proto, 1)
+
+m = re.search(r'\n([ \t]*)if \(!cnt\) cnt = name_from_(emscripten|dns_search)\(', content)
+if m and proto in content:
+    ind = m.group(1)
+    call = (ind + 'if (!cnt) {\n'
+            + ind + '\tcnt = _emscripten_lookup_name_all(name, family, buf, MAXADDRS);\n'
+            + ind + '\tif (cnt > 0 && !(flags & AI_V4MAPPED)) return cnt;\n'
+            + ind + '\tif (cnt < 0) cnt = 0;\n'
+            + ind + '}\n')
+    content = content[:m.start() + 1] + call + content[m.start() + 1:]
+    with open(path, 'w') as f:
+        f.write(content)
+    print('Patched ' + path + ': multi-address lookups via _emscripten_lookup_name_all')
+else:
+    print('WARNING: Could not find the DNS lookup call in ' + path)
+"
+fi
+
+# 6f. Route musl's sendfile() to __syscall_sendfile in libdirectsockets.js,
+# which splices file data into the socket without a round trip through the
+# Wasm heap. Upstream emscripten has no sendfile syscall to forward to.
+SENDFILE="$EMDIR/system/lib/libc/musl/src/linux/sendfile.c"
+if [ -f "$SENDFILE" ] && ! grep -q '__syscall_sendfile' "$SENDFILE" 2>/dev/null; then
+python3 -c "
+import re
+path = '$SENDFILE'
+with open(path) as f:
+    content = f.read()
+
+m = re.search(r'return syscall\(SYS_sendfile[^;]*;', content)
+if m:
+    proto = 'int __syscall_sendfile(int out_fd, int in_fd, intptr_t ofs, size_t count);\n'
+    content = content.replace('#include \"syscall.h\"\n', '#include \"syscall.h\"\n' + proto, 1)
+    content = content.replace(m.group(0),
+        'return __syscall_ret(__syscall_sendfile(out_fd, in_fd, (intptr_t)ofs, count));')
+    with open(path, 'w') as f:
+        f.write(content)
+    print('Patched ' + path + ': sendfile via __syscall_sendfile')
+else:
+    print('WARNING: Could not find the sendfile syscall in ' + path)
+"
+fi
+
 # 7. Clear emscripten cache to pick up JS changes
 rm -rf "$EMDIR/cache"
 echo "Cleared cache"
@@ -392,6 +441,20 @@ em++ "$SRCDIR/test_direct_sockets.cpp" -o "$BUILDDIR/test.js" \
   -sALLOW_MEMORY_GROWTH=1 \
   2>&1
 
+echo ""
+echo "=== Compiling bench_direct_sockets.cpp ==="
+echo ""
+
+em++ "$SRCDIR/stress-test/microbench/bench_direct_sockets.cpp" -o "$BUILDDIR/bench.js" \
+  -O2 \
+  -sDIRECT_SOCKETS \
+  -sJSPI \
+  -sPROXY_TO_PTHREAD \
+  -pthread \
+  -sEXIT_RUNTIME=1 \
+  -sALLOW_MEMORY_GROWTH=1 \
+  2>&1
+
 echo ""
 echo "=== Build complete ==="
-ls -la "$BUILDDIR/test."*
+ls -la "$BUILDDIR/test."* "$BUILDDIR/bench."*
@@ -13,16 +13,44 @@
 
 var DirectSocketsLibrary = {
 
-  $DIRECT_SOCKETS__deps: ['$readSockaddr', '$writeSockaddr', '$DNS', '$inetNtop4', '$inetNtop6', '$FS'],
+  $DIRECT_SOCKETS__deps: ['$readSockaddr', '$writeSockaddr', '$DNS', '$inetNtop4', '$inetNtop6', '$FS', '$DIRECT_SOCKETS_TIMERS', '$DIRECT_SOCKETS_DNS', '$DIRECT_SOCKETS_STATS', '$DIRECT_SOCKETS_TRACE', '$DIRECT_SOCKETS_POOL'],
   $DIRECT_SOCKETS: {
-    // fd -> socket state mapping
-    sockets: {},
+    // fd -> socket state (see setSocket)
+    sockets: [],
 
     // Monotonic counter for unique socket/pipe node names
     nextId: 0,
 
-    // DNS cache: hostname -> {addresses: [...], expires: timestamp}
+    // Bytes a socket may have queued on its writer before POLLOUT is
+    // withheld, when SO_SNDBUF was not set.
+    DEFAULT_SNDBUF: 256 * 1024,
+
+    // Write coalescing: buffered bytes are flushed as one writer.write() once
+    // they reach CORK_FLUSH_BYTES (one maximum-size TLS record), and corked
+    // data is never held longer than CORK_MAX_MS (Linux TCP_CORK ceiling).
+    CORK_FLUSH_BYTES: 16384,
+    CORK_MAX_MS: 200,
+
+    // Gathered writes are carved out of SEND_SLAB-sized buffers so a small
+    // writev() costs no allocation. A region is never reused (the writer may
+    // still hold it); the slab is dropped once its last region settles.
+    SEND_SLAB: 256 * 1024,
+    sendSlab: null,
+    sendSlabUsed: 0,
+
+    // sendfile() reads files in chunks of this size and queues them to the
+    // socket writer back to back while the send buffer has room
+    SPLICE_CHUNK: 64 * 1024,
+
+    // listen() backlogs are clamped to [1, SOMAXCONN] (Linux default)
+    SOMAXCONN: 4096,
+
+    // Resolved-address bookkeeping for parseSockaddr:
+    // '_real_' + hostname -> ip, '_reverse_' + ip -> hostname
     dnsCache: {},
+    // Bumped whenever dnsCache gains reverse entries, which invalidates the
+    // per-socket destinations memoized by peerDest
+    dnsGeneration: 0,
 
     // FS mount point for socket nodes (initialized lazily)
     root: null,
@@ -34,13 +62,16 @@ var DirectSocketsLibrary = {
     stream_ops: {
       read(stream, buffer, offset, length, position) {
         var sock = stream.node.sock;
+        // Non-blocking connect still in flight
+        if (sock && sock.state === 'connecting') throw new FS.ErrnoError({{{ cDefs.EAGAIN }}});
         if (!sock || (sock.state !== 'connected' && sock.state !== 'bound')) return 0;
 
         // Synchronous: consume from recvQueue (filled by background reader)
         if (sock.recvQueue.length > 0) {
           var entry = sock.recvQueue[0];
-          // UDP datagrams are {data, remoteAddress, remotePort}; TCP chunks are Uint8Array
-          var chunk = entry.data ? entry.data : entry;
+          // UDP queues Datagram records; TCP chunks are Uint8Array
+          var datagram = sock.type !== {{{ cDefs.SOCK_STREAM }}};
+          var chunk = datagram ? entry.data : entry;
           var toRead = Math.min(chunk.length, length);
           for (var i = 0; i < toRead; i++) {
             buffer[offset + i] = chunk[i];
@@ -49,7 +80,7 @@ var DirectSocketsLibrary = {
             sock.recvQueue.shift();
           } else {
             // Partial read: for TCP, keep remainder; for UDP, discard (datagram semantics)
-            if (entry.data) {
+            if (datagram) {
               sock.recvQueue.shift(); // UDP: truncate
             } else {
               sock.recvQueue[0] = chunk.slice(toRead);
@@ -71,6 +102,7 @@ var DirectSocketsLibrary = {
       },
       write(stream, buffer, offset, length, position) {
         var sock = stream.node.sock;
+        if (sock && sock.state === 'connecting') throw new FS.ErrnoError({{{ cDefs.EAGAIN }}});
         if (!sock || !sock.writer) {
           throw new FS.ErrnoError({{{ cDefs.ENOTCONN }}});
         }
@@ -80,7 +112,14 @@ var DirectSocketsLibrary = {
           data[i] = buffer[offset + i];
         }
         // Fire-and-forget: queue the write, return byte count immediately.
-        // The browser/OS handles TCP buffering and backpressure.
+        // Backpressure is surfaced through POLLOUT (see isWritable).
+        // Consecutive write()s (and writev iovecs) before the program next
+        // yields are coalesced into one writer.write().
+        if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
+          DIRECT_SOCKETS.bufferWrite(sock, data, false);
+          return length;
+        }
+        DIRECT_SOCKETS_STATS.sent(sock, length, true);
         sock.writer.write(data).catch(function(e) {
           // write error - socket will be cleaned up by close
           sock.error = {{{ cDefs.EIO }}};
@@ -92,7 +131,7 @@ var DirectSocketsLibrary = {
         if (!sock) return 0;
         var mask = 0;
         if (sock.recvQueue.length > 0 || sock._bgReaderDone) mask |= {{{ cDefs.POLLIN | 64 /*POLLRDNORM*/ }}};
-        if (sock.writer && sock.state === 'connected') mask |= {{{ cDefs.POLLOUT | 256 /*POLLWRNORM*/ }}};
+        if (DIRECT_SOCKETS.isWritable(sock)) mask |= {{{ cDefs.POLLOUT | 256 /*POLLWRNORM*/ }}};
         if (sock._bgReaderDone && sock.recvQueue.length === 0) mask |= {{{ cDefs.POLLHUP }}};
         if (sock.error) mask |= {{{ cDefs.POLLERR }}};
         return mask;
@@ -100,7 +139,7 @@ var DirectSocketsLibrary = {
       close(stream) {
         var sock = stream.node.sock;
         if (sock) {
-          delete DIRECT_SOCKETS.sockets[sock.fd];
+          DIRECT_SOCKETS.sockets[sock.fd] = null;
           sock.stream = null; // prevent _closeSocket from double-closing FS stream
           DIRECT_SOCKETS._closeSocket(sock);
         }
@@ -114,9 +153,107 @@ var DirectSocketsLibrary = {
     },
 
     getSocket(fd) {
-      var sock = DIRECT_SOCKETS.sockets[fd];
-      if (!sock) return null;
-      return sock;
+      return DIRECT_SOCKETS.sockets[fd] || null;
+    },
+
+    // Socket state. TCP and UDP sockets are separate constructors so each
+    // send/recv path only ever sees one hidden class; both start with the
+    // common fields in the same order. Every field keeps one type for the
+    // socket's lifetime (ports are 0 and addresses '' until known), so no
+    // store generalizes a field and deoptimizes code that was built on it.
+    initCommon(sock, family, type, protocol) {
+      sock.fd = 0; // will be set after FS.createStream
+      sock.family = family;
+      sock.type = type;
+      sock.protocol = protocol;
+      sock.state = 'created';
+      sock.options = {
+        noDelay: false,
+        keepAliveDelay: 0,
+        sendBufferSize: 0,
+        receiveBufferSize: 0,
+        multicastTtl: 1,
+        multicastLoopback: true,
+      };
+      sock.localAddress = '';
+      sock.localPort = 0;
+      sock.remoteAddress = '';
+      sock.remotePort = 0;
+      sock.reader = null;
+      sock.writer = null;
+      sock.error = 0;
+      // Background reader / recv queue fields. TCP queues Uint8Array
+      // chunks, UDP queues Datagram records.
+      sock.recvQueue = [];
+      sock._bgReaderRunning = false;
+      sock._bgReaderDone = false;
+      // Bytes handed to writer.write() that have not settled yet
+      sock.writeQueued = 0;
+      // Bytes held back by write coalescing (always 0 on UDP)
+      sock.sendPendingBytes = 0;
+      // writer.write() calls issued, for comparing write paths
+      sock.writeCalls = 0;
+      // Readiness notifications for poll/epoll/blocking waits
+      sock.readiness = DIRECT_SOCKETS.createReadiness();
+      // I/O counters (DIRECT_SOCKETS_STATS)
+      sock.stats = DIRECT_SOCKETS_STATS.create();
+      // Non-blocking mode
+      sock.nonBlocking = false;
+      sock.flags = 0;
+      // FS integration
+      sock.stream = null;
+    },
+
+    TCPState: function(family, type, protocol) {
+      DIRECT_SOCKETS.initCommon(this, family, type, protocol);
+      this.tcpSocket = null;
+      // Outbound connections: the readable stream (so a reader can be
+      // re-acquired) and the DIRECT_SOCKETS_POOL key, '' if not poolable
+      this.readable = null;
+      this.poolKey = '';
+      this.tcpServer = null;
+      this.acceptReader = null;
+      // Listener accept queue: connections whose streams are already
+      // open, filled by the accept loop up to acceptBacklog
+      this.acceptQueue = [];
+      this.acceptBacklog = 0;
+      this.acceptOpening = 0;
+      this._acceptLoopRunning = false;
+      this._acceptDone = false;
+      // Write coalescing (TCP_CORK / MSG_MORE / same-tick writes)
+      this.cork = false;
+      this.sendPending = [];
+      this._flushScheduled = false;
+      this._corkTimer = null;
+    },
+
+    UDPState: function(family, type, protocol) {
+      DIRECT_SOCKETS.initCommon(this, family, type, protocol);
+      this.udpSocket = null;
+      this.multicastController = null;
+      this.joinedMulticastGroups = [];
+      // Per-peer addressing caches (peerDest, writePeer) and the parsed
+      // destination of connect(), for sendto() naming the connected peer
+      this.lastDest = null;
+      this.lastSource = null;
+      this.connectedDest = null;
+    },
+
+    // A received UDP datagram. Direct Sockets messages omit the remote
+    // address on connected sockets; copying them into one record shape keeps
+    // the recv paths monomorphic.
+    Datagram: function(data, remoteAddress, remotePort) {
+      this.data = data;
+      this.remoteAddress = remoteAddress || '';
+      this.remotePort = remotePort || 0;
+    },
+
+    // Sockets indexed by fd. Closed or unused slots hold null so the array
+    // stays dense.
+    setSocket(fd, sock) {
+      var table = DIRECT_SOCKETS.sockets;
+      while (table.length < fd) table.push(null);
+      table[fd] = sock;
     },
 
     createSocketState(family, type, protocol) {
@@ -133,44 +270,9 @@ var DirectSocketsLibrary = {
       var name = 'socket[' + (DIRECT_SOCKETS.nextId++) + ']';
       var node = FS.createNode(DIRECT_SOCKETS.root, name, {{{ cDefs.S_IFSOCK }}}, 0);
 
-      var sock = {
-        fd: 0, // will be set after FS.createStream
-        family: family,
-        type: type,
-        protocol: protocol,
-        state: 'created',
-        options: {
-          noDelay: false,
-          keepAliveDelay: 0,
-          sendBufferSize: 0,
-          receiveBufferSize: 0,
-        },
-        localAddress: null,
-        localPort: null,
-        remoteAddress: null,
-        remotePort: null,
-        tcpSocket: null,
-        tcpServer: null,
-        udpSocket: null,
-        reader: null,
-        writer: null,
-        acceptReader: null,
-        readBuffer: null,
-        readBufferOffset: 0,
-        multicastController: null,
-        joinedMulticastGroups: [],
-        error: 0,
-        // Background reader / recv queue fields
-        recvQueue: [],
-        _bgReaderRunning: false,
-        _bgReaderDone: false,
-        _waiters: [],
-        // Non-blocking mode
-        nonBlocking: false,
-        flags: 0,
-        // FS integration
-        stream: null,
-      };
+      var sock = type === {{{ cDefs.SOCK_STREAM }}}
+        ? new DIRECT_SOCKETS.TCPState(family, type, protocol)
+        : new DIRECT_SOCKETS.UDPState(family, type, protocol);
 
       // Attach socket to node (so stream_ops can find it)
       node.sock = sock;
@@ -186,32 +288,146 @@ var DirectSocketsLibrary = {
       sock.stream = stream;
       sock.fd = stream.fd;
 
-      DIRECT_SOCKETS.sockets[sock.fd] = sock;
+      DIRECT_SOCKETS.setSocket(sock.fd, sock);
       return sock;
     },
 
-    // Notify all registered waiters on a socket
-    _notifyWaiters(sock) {
-      if (sock._waiters && sock._waiters.length > 0) {
-        var waiters = sock._waiters.slice();
-        sock._waiters = [];
-        for (var i = 0; i < waiters.length; i++) {
-          waiters[i]();
+    // Readiness object shared by sockets and pipes (one per fd). Anything
+    // that can change the fd's poll state bumps `gen` and calls every
+    // subscriber; subscribers re-check state themselves, and edge consumers
+    // (epoll EPOLLET) compare `gen` to tell a new edge from one they have
+    // already reported. Subscribers stay registered until they unsubscribe.
+    createReadiness() {
+      return { gen: 0, closed: false, subscribers: new Set() };
+    },
+
+    subscribe(rd, cb) {
+      rd.subscribers.add(cb);
+    },
+
+    unsubscribe(rd, cb) {
+      rd.subscribers.delete(cb);
+    },
+
+    signal(rd) {
+      rd.gen++;
+      if (rd.subscribers.size === 0) return;
+      for (var cb of rd.subscribers) cb(rd);
+    },
+
+    // Final signal for an fd that is going away, then drop all subscribers
+    closeReadiness(rd) {
+      rd.closed = true;
+      DIRECT_SOCKETS.signal(rd);
+      rd.subscribers.clear();
+    },
+
+    // Resolve once the socket has at least minBytes (default 1) queued,
+    // reached EOF, or failed
+    waitReadable(sock, minBytes) {
+      minBytes = minBytes || 1;
+      return new Promise(function(resolve) {
+        var rd = sock.readiness;
+        var check = function() {
+          if (DIRECT_SOCKETS.queuedBytes(sock, minBytes) >= minBytes ||
+              sock._bgReaderDone || sock.error || rd.closed) {
+            DIRECT_SOCKETS.unsubscribe(rd, check);
+            resolve();
+          }
+        };
+        DIRECT_SOCKETS.subscribe(rd, check);
+      });
+    },
+
+    // Resolve once the send buffer has room again, or the socket failed
+    waitWritable(sock) {
+      return new Promise(function(resolve) {
+        var rd = sock.readiness;
+        var check = function() {
+          if (DIRECT_SOCKETS.isWritable(sock) || sock.error || !sock.writer || rd.closed) {
+            DIRECT_SOCKETS.unsubscribe(rd, check);
+            resolve();
+          }
+        };
+        DIRECT_SOCKETS.subscribe(rd, check);
+      });
+    },
+
+    // A socket is writable once connected and while its queued-but-unsent
+    // bytes stay under the send buffer size.
+    isWritable(sock) {
+      if (!sock.writer || (sock.state !== 'connected' && sock.state !== 'bound')) return false;
+      var queued = sock.writeQueued + sock.sendPendingBytes;
+      return queued < (sock.options.sendBufferSize || DIRECT_SOCKETS.DEFAULT_SNDBUF);
+    },
+
+    // Append to the socket's coalescing buffer. Uncorked data without
+    // MSG_MORE goes out at the end of the current microtask; corked or
+    // MSG_MORE data waits for uncork, the size threshold or CORK_MAX_MS.
+    bufferWrite(sock, data, more) {
+      sock.sendPending.push(data);
+      sock.sendPendingBytes += data.length;
+      if (sock.sendPendingBytes >= DIRECT_SOCKETS.CORK_FLUSH_BYTES) {
+        DIRECT_SOCKETS.flushWrites(sock);
+      } else if (!sock.cork && !more) {
+        if (!sock._flushScheduled) {
+          sock._flushScheduled = true;
+          queueMicrotask(function() {
+            sock._flushScheduled = false;
+            if (!sock.cork) DIRECT_SOCKETS.flushWrites(sock);
+          });
         }
+      } else if (!sock._corkTimer) {
+        sock._corkTimer = DIRECT_SOCKETS_TIMERS.add(DIRECT_SOCKETS.CORK_MAX_MS, function() {
+          sock._corkTimer = null;
+          DIRECT_SOCKETS.flushWrites(sock);
+        });
       }
     },
 
-    // Register a waiter callback on a socket (supports multiple concurrent waiters)
-    _addWaiter(sock, cb) {
-      if (!sock._waiters) sock._waiters = [];
-      sock._waiters.push(cb);
+    // Send everything buffered as a single writer.write(). Errors are
+    // recorded on the socket; callers that need them await the result.
+    flushWrites(sock) {
+      if (sock._corkTimer) {
+        DIRECT_SOCKETS_TIMERS.cancel(sock._corkTimer);
+        sock._corkTimer = null;
+      }
+      if (sock.sendPendingBytes === 0 || !sock.writer) return Promise.resolve();
+      var chunks = sock.sendPending;
+      var data = chunks[0];
+      if (chunks.length > 1) {
+        data = new Uint8Array(sock.sendPendingBytes);
+        for (var i = 0, off = 0; i < chunks.length; i++) {
+          data.set(chunks[i], off);
+          off += chunks[i].length;
+        }
+      }
+      sock.sendPending = [];
+      sock.sendPendingBytes = 0;
+      var p = DIRECT_SOCKETS.queueWrite(sock, data);
+      p.catch(function(e) {
+        // write error - socket will be cleaned up by close
+        sock.error = {{{ cDefs.EIO }}};
+      });
+      return p;
     },
 
-    // Remove a specific waiter callback
-    _removeWaiter(sock, cb) {
-      if (!sock._waiters) return;
-      var idx = sock._waiters.indexOf(cb);
-      if (idx >= 0) sock._waiters.splice(idx, 1);
+    // Hand data to the writer with send-buffer accounting. The write that
+    // brings the queue back under the limit signals readiness so that
+    // write-blocked pollers wake.
+    queueWrite(sock, data) {
+      var n = data.length;
+      sock.writeQueued += n;
+      sock.writeCalls++;
+      DIRECT_SOCKETS_STATS.sent(sock, n, false);
+      var settle = function() {
+        var blocked = !DIRECT_SOCKETS.isWritable(sock);
+        sock.writeQueued -= n;
+        if (blocked && DIRECT_SOCKETS.isWritable(sock)) DIRECT_SOCKETS.signal(sock.readiness);
+      };
+      var p = sock.writer.write(data);
+      p.then(settle, settle);
+      return p;
     },
 
     // Start a background reader loop that pumps data into recvQueue
@@ -226,8 +442,14 @@ var DirectSocketsLibrary = {
             if (done || !value) {
               sock._bgReaderDone = true; break;
             }
-            sock.recvQueue.push(value);
-            DIRECT_SOCKETS._notifyWaiters(sock);
+            var stream = sock.type === {{{ cDefs.SOCK_STREAM }}};
+            var n = stream ? value.length : value.data.length;
+            sock.recvQueue.push(stream ? value : new DIRECT_SOCKETS.Datagram(value.data, value.remoteAddress, value.remotePort));
+            DIRECT_SOCKETS_STATS.received(sock, n, !stream);
+            if (DIRECT_SOCKETS_TRACE.on) {
+              DIRECT_SOCKETS_TRACE.instant('deliver', 'direct_sockets.reader', { fd: sock.fd, bytes: n, queued: sock.recvQueue.length });
+            }
+            DIRECT_SOCKETS.signal(sock.readiness);
           }
         } catch (e) {
           // bgReader error - mark done
@@ -236,10 +458,95 @@ var DirectSocketsLibrary = {
         }
         sock._bgReaderRunning = false;
         // Notify on close/error too
-        DIRECT_SOCKETS._notifyWaiters(sock);
+        DIRECT_SOCKETS.signal(sock.readiness);
+      })();
+    },
+
+    // Pull connections off a listener's TCPServerSocket ahead of accept().
+    // Each one is opened (readable/writable locked) concurrently and queued
+    // once ready, so accept4 pops without awaiting and the listener polls
+    // POLLIN. The loop stops reading while backlog connections are queued or
+    // opening, which leaves further clients in the server socket's own queue.
+    startAcceptLoop(sock) {
+      if (sock._acceptLoopRunning) return;
+      sock._acceptLoopRunning = true;
+
+      (async () => {
+        try {
+          while (sock.acceptReader && sock.state === 'listening') {
+            if (sock.acceptQueue.length + sock.acceptOpening >= sock.acceptBacklog) {
+              await DIRECT_SOCKETS.waitAcceptRoom(sock);
+              continue;
+            }
+            var { value: tcpSocket, done } = await sock.acceptReader.read();
+            if (done || !tcpSocket) {
+              sock._acceptDone = true; break;
+            }
+            DIRECT_SOCKETS.prefetchAccepted(sock, tcpSocket);
+          }
+        } catch (e) {
+          // Server socket failed or was closed under us
+          sock._acceptDone = true;
+        }
+        sock._acceptLoopRunning = false;
+        DIRECT_SOCKETS.signal(sock.readiness);
       })();
     },
 
+    prefetchAccepted(sock, tcpSocket) {
+      sock.acceptOpening++;
+      tcpSocket.opened.then((openInfo) => {
+        sock.acceptOpening--;
+        if (sock.state !== 'listening' || sock.readiness.closed) {
+          try { tcpSocket.close(); } catch (e) {}
+          return;
+        }
+        sock.acceptQueue.push({
+          tcpSocket: tcpSocket,
+          openInfo: openInfo,
+          reader: openInfo.readable.getReader(),
+          writer: openInfo.writable.getWriter(),
+        });
+        DIRECT_SOCKETS.signal(sock.readiness);
+      }, (e) => {
+        // Reset before it could be opened: drop it, as the kernel would
+        sock.acceptOpening--;
+#if SOCKET_DEBUG
+        dbg(`direct_sockets: accepted connection failed to open: ${e}`);
+#endif
+        DIRECT_SOCKETS.signal(sock.readiness);
+      });
+    },
+
+    // Resolve once the accept queue has room again (or the listener is gone)
+    waitAcceptRoom(sock) {
+      return new Promise(function(resolve) {
+        var rd = sock.readiness;
+        var check = function() {
+          if (sock.acceptQueue.length + sock.acceptOpening < sock.acceptBacklog ||
+              sock.state !== 'listening' || rd.closed) {
+            DIRECT_SOCKETS.unsubscribe(rd, check);
+            resolve();
+          }
+        };
+        DIRECT_SOCKETS.subscribe(rd, check);
+      });
+    },
+
+    // Resolve once a connection is queued or the listener has failed
+    waitAcceptable(sock) {
+      return new Promise(function(resolve) {
+        var rd = sock.readiness;
+        var check = function() {
+          if (sock.acceptQueue.length > 0 || sock._acceptDone || rd.closed) {
+            DIRECT_SOCKETS.unsubscribe(rd, check);
+            resolve();
+          }
+        };
+        DIRECT_SOCKETS.subscribe(rd, check);
+      });
+    },
+
     // Parse a sockaddr struct from Wasm memory.
     // Returns {family, addr, port} on success, or {errno} on failure.
     parseSockaddr(addrPtr, addrLen) {
@@ -252,7 +559,7 @@ var DirectSocketsLibrary = {
       var addr = info.addr;
       var reverseHostname = DIRECT_SOCKETS.dnsCache['_reverse_' + addr];
       if (reverseHostname) {
-        return { family: info.family, addr: reverseHostname, port: info.port };
+        return { family: info.family, addr: reverseHostname, ip: addr, port: info.port };
       }
 
       // Fall back to emscripten's DNS reverse lookup (for fake 172.29.x.x IPs)
@@ -260,6 +567,84 @@ var DirectSocketsLibrary = {
       return { family: info.family, addr: resolvedAddr, port: info.port };
     },
 
+    // parseSockaddr for datagram destinations, memoized per socket on the raw
+    // sockaddr bytes. A sender talking to one peer, like a QUIC connection,
+    // then skips readSockaddr and the reverse lookups on every packet. Only
+    // family, port and address are compared for AF_INET, since sin_zero is
+    // often left uninitialized.
+    peerDest(sock, addrPtr, addrLen) {
+      var c = sock.lastDest;
+      if (c && c.addrLen === addrLen && c.generation === DIRECT_SOCKETS.dnsGeneration) {
+        var key = c.key, i = 0;
+        while (i < key.length && HEAPU8[addrPtr + i] === key[i]) i++;
+        if (i === key.length) return c.dest;
+      }
+      var dest = DIRECT_SOCKETS.parseSockaddr(addrPtr, addrLen);
+      if (dest.errno) return dest;
+      var n = dest.family === {{{ cDefs.AF_INET }}} ? Math.min(8, addrLen) : addrLen;
+      sock.lastDest = {
+        key: HEAPU8.slice(addrPtr, addrPtr + n),
+        addrLen: addrLen,
+        generation: DIRECT_SOCKETS.dnsGeneration,
+        dest: dest,
+      };
+      return dest;
+    },
+
+    // writeSockaddr for a datagram's source, memoized per socket on the last
+    // (address, port) written: a repeat peer is one copy of the cached bytes
+    writePeer(sock, addrPtr, addrlenPtr, address, port) {
+      var c = sock.lastSource;
+      if (!c || c.address !== address || c.port !== port) {
+        var errno = writeSockaddr(addrPtr, sock.family, DNS.lookup_name(address), port, addrlenPtr);
+        if (errno) return errno;
+        var n = sock.family === {{{ cDefs.AF_INET6 }}} ? {{{ C_STRUCTS.sockaddr_in6.__size__ }}} : {{{ C_STRUCTS.sockaddr_in.__size__ }}};
+        sock.lastSource = { address: address, port: port, bytes: HEAPU8.slice(addrPtr, addrPtr + n) };
+        return 0;
+      }
+      HEAPU8.set(c.bytes, addrPtr);
+      if (addrlenPtr) {{{ makeSetValue('addrlenPtr', 0, 'c.bytes.length', 'i32') }}};
+      return 0;
+    },
+
+    // Send one datagram for sendto()/sendmsg(), to the sockaddr at addrPtr
+    // if given. Naming the connected peer is allowed, as on Linux, and takes
+    // the connected-mode write. Resolves to the length or a negative errno.
+    async sendDatagram(sock, data, addrPtr, addrLen) {
+      var chunk;
+      if (addrPtr && addrLen > 0) {
+        var dest = DIRECT_SOCKETS.peerDest(sock, addrPtr, addrLen);
+        if (dest.errno) return -dest.errno;
+#if SOCKET_DEBUG
+        dbg(`direct_sockets: sendto(fd=${sock.fd}, length=${data.length}, dest=${dest.addr}:${dest.port})`);
+#endif
+        var peer = sock.connectedDest;
+        if (sock.state === 'connected' && peer && dest.port === peer.port && dest.addr === peer.addr) {
+          chunk = { data: data };
+        } else if (sock.state === 'bound' && sock.writer) {
+          chunk = { data: data, remoteAddress: dest.addr, remotePort: dest.port };
+        } else {
+          return -{{{ cDefs.EDESTADDRREQ }}};
+        }
+      } else {
+        if (sock.state !== 'connected') return -{{{ cDefs.EDESTADDRREQ }}};
+#if SOCKET_DEBUG
+        dbg(`direct_sockets: send(fd=${sock.fd}, length=${data.length}) [connected UDP]`);
+#endif
+        chunk = { data: data };
+      }
+      try {
+        DIRECT_SOCKETS_STATS.sent(sock, data.length, true);
+        await sock.writer.write(chunk);
+        return data.length;
+      } catch (e) {
+#if SOCKET_DEBUG
+        dbg(`direct_sockets: sendto error: ${e}`);
+#endif
+        return -{{{ cDefs.ENETUNREACH }}};
+      }
+    },
+
     // Build TCPSocketOptions from deferred socket options.
     buildTCPOptions(sock) {
       var opts = {};
@@ -335,73 +720,174 @@ var DirectSocketsLibrary = {
       }
     },
 
-    // Read from Direct Sockets, consuming from recvQueue first (sync path),
-    // then falling back to blocking await if queue is empty.
-    // Returns a Uint8Array of up to `length` bytes, or null if closed.
-    async readFromSocket(sock, length) {
-      // First consume any buffered data from a previous over-read (legacy readBuffer).
-      if (sock.readBuffer && sock.readBufferOffset < sock.readBuffer.length) {
-        var remaining = sock.readBuffer.length - sock.readBufferOffset;
-        var toReturn = Math.min(remaining, length);
-        var result = sock.readBuffer.slice(sock.readBufferOffset, sock.readBufferOffset + toReturn);
-        sock.readBufferOffset += toReturn;
-        if (sock.readBufferOffset >= sock.readBuffer.length) {
-          sock.readBuffer = null;
-          sock.readBufferOffset = 0;
+    // Open a TCP connection for connect(). Resolves to 0 or a negative
+    // errno; readiness is signalled either way so POLLOUT/POLLERR waiters
+    // of a non-blocking connect wake up.
+    async openTCP(sock, dest) {
+      // TCP connect - pass local endpoint from prior bind() if present
+      var opts = DIRECT_SOCKETS.buildTCPOptions(sock);
+      if (sock.localAddress && sock.localAddress !== '0.0.0.0') {
+        opts.localAddress = sock.localAddress;
+      }
+      if (sock.localPort) {
+        opts.localPort = sock.localPort;
+      }
+      var key = DIRECT_SOCKETS_POOL.key(sock, dest, opts);
+      var pooled = key && DIRECT_SOCKETS_POOL.checkout(key);
+      if (pooled) {
+        DIRECT_SOCKETS_POOL.adopt(sock, pooled);
+        DIRECT_SOCKETS.startBackgroundReader(sock);
+        DIRECT_SOCKETS.signal(sock.readiness);
+        return 0;
+      }
+      // Happy Eyeballs only for names we resolved, and only when no local
+      // address pins the family
+      var race = Module['directSocketsHappyEyeballs'] && dest.ip && !opts.localAddress;
+      try {
+        if (race) {
+          delete opts.dnsQueryType;
+          var won = await DIRECT_SOCKETS_DNS.happyEyeballs(dest.addr, dest.port, opts);
+          if (!won.socket) throw won.error;
+          var tcpSocket = won.socket;
+          var openInfo = won.openInfo;
+        } else {
+          var tcpSocket = new TCPSocket(dest.addr, dest.port, opts);
+          var openInfo = await tcpSocket.opened;
         }
-        return result;
+      } catch (e) {
+#if SOCKET_DEBUG
+        dbg(`direct_sockets: connect error: ${e}`);
+#endif
+        if (sock.state === 'closed') return -{{{ cDefs.EBADF }}};
+        sock.state = (sock.localAddress || sock.localPort) ? 'bound' : 'created';
+        DIRECT_SOCKETS.signal(sock.readiness);
+        if (e.name === 'NotAllowedError') return -{{{ cDefs.EACCES }}};
+        return -{{{ cDefs.ECONNREFUSED }}};
       }
 
-      // Consume from recvQueue (filled by background reader)
-      if (sock.recvQueue.length > 0) {
-        var chunk = sock.recvQueue[0];
+      // close() raced with a non-blocking connect: drop the new connection
+      if (sock.state === 'closed') {
+        try { await tcpSocket.close(); } catch (e) {}
+        return -{{{ cDefs.EBADF }}};
+      }
+
+      sock.tcpSocket = tcpSocket;
+      sock.readable = openInfo.readable;
+      sock.reader = openInfo.readable.getReader();
+      sock.writer = openInfo.writable.getWriter();
+      sock.poolKey = key;
+      sock.remoteAddress = openInfo.remoteAddress || dest.addr;
+      // The race may have won on the other family; report the address the
+      // caller connected to rather than one its sockaddr can't hold
+      if (race && won.family !== sock.family) sock.remoteAddress = dest.ip;
+      sock.remotePort = openInfo.remotePort || dest.port;
+      sock.localAddress = openInfo.localAddress || sock.localAddress || '0.0.0.0';
+      sock.localPort = openInfo.localPort || sock.localPort || 0;
+      sock.state = 'connected';
+
+      // Start background reader for poll/non-blocking support
+      DIRECT_SOCKETS.startBackgroundReader(sock);
+      // Writer is now available: wake POLLOUT/EPOLLOUT watchers
+      DIRECT_SOCKETS.signal(sock.readiness);
+      return 0;
+    },
+
+    // Bytes in the TCP receive queue, counting no further than `cap`
+    queuedBytes(sock, cap) {
+      var q = sock.recvQueue, n = 0;
+      for (var i = 0; i < q.length && n < cap; i++) {
+        n += q[i].length;
+      }
+      return n;
+    },
+
+    // Take up to `length` bytes from the front of the TCP receive queue,
+    // spanning chunks. With `peek` the queue is left untouched.
+    takeFromQueue(sock, length, peek) {
+      var q = sock.recvQueue;
+      var chunk = q[0];
+      if (chunk.length >= length || q.length === 1) {
         if (chunk.length <= length) {
-          sock.recvQueue.shift();
+          if (!peek) q.shift();
           return chunk;
         }
-        // Partial consume
-        var result = chunk.slice(0, length);
-        sock.recvQueue[0] = chunk.slice(length);
-        return result;
+        if (!peek) q[0] = chunk.subarray(length);
+        return chunk.subarray(0, length);
+      }
+      var out = new Uint8Array(Math.min(length, DIRECT_SOCKETS.queuedBytes(sock, length)));
+      var off = 0, i = 0;
+      while (off < out.length) {
+        chunk = q[i];
+        var n = Math.min(chunk.length, out.length - off);
+        out.set(n === chunk.length ? chunk : chunk.subarray(0, n), off);
+        off += n;
+        if (peek) {
+          i++;
+        } else if (n === chunk.length) {
+          q.shift();
+        } else {
+          q[0] = chunk.subarray(n);
+        }
+      }
+      return out;
+    },
+
+    // Read from Direct Sockets, consuming from recvQueue first (sync path),
+    // then falling back to blocking await if queue is empty.
+    // Returns a Uint8Array of up to `length` bytes, or null if closed.
+    // Honors MSG_PEEK, MSG_DONTWAIT and MSG_WAITALL in `flags`.
+    async readFromSocket(sock, length, flags) {
+      flags = flags || 0;
+      var peek = !!(flags & 2 /*MSG_PEEK*/);
+      var nonBlocking = sock.nonBlocking || !!(flags & 0x40 /*MSG_DONTWAIT*/);
+
+      // MSG_WAITALL on a blocking read: wait for the whole request in one
+      // suspension instead of returning short reads
+      var want = (flags & 0x100 /*MSG_WAITALL*/) && !nonBlocking ? length : 1;
+
+      // Consume from recvQueue (filled by background reader)
+      if (sock.recvQueue.length > 0 &&
+          (want === 1 || sock._bgReaderDone || sock.error || DIRECT_SOCKETS.queuedBytes(sock, want) >= want)) {
+        return DIRECT_SOCKETS.takeFromQueue(sock, length, peek);
       }
 
-      // Queue is empty - check for errors before reporting EOF
-      if (sock.error) return -{{{ cDefs.EIO }}};
-      if (sock._bgReaderDone) return null;  // EOF
+      if (sock.recvQueue.length === 0) {
+        // Queue is empty - check for errors before reporting EOF
+        if (sock.error) return -{{{ cDefs.EIO }}};
+        if (sock._bgReaderDone) return null;  // EOF
 
-      // Non-blocking: return EAGAIN sentinel
-      if (sock.nonBlocking) return 'EAGAIN';
+        // Non-blocking: return EAGAIN sentinel
+        if (nonBlocking) return 'EAGAIN';
+      }
 
       // Blocking: wait for data to arrive via background reader
       if (!sock._bgReaderRunning && sock.reader) {
         DIRECT_SOCKETS.startBackgroundReader(sock);
       }
 
-      return new Promise(function(resolve) {
-        var onData = function() {
-          if (sock.recvQueue.length > 0) {
-            var chunk = sock.recvQueue[0];
-            if (chunk.length <= length) {
-              sock.recvQueue.shift();
-              resolve(chunk);
-            } else {
-              var result = chunk.slice(0, length);
-              sock.recvQueue[0] = chunk.slice(length);
-              resolve(result);
-            }
-          } else if (sock.error) {
-            resolve(-sock.error);  // Return negative errno
-          } else {
-            // EOF
-            resolve(null);
-          }
-        };
-        DIRECT_SOCKETS._addWaiter(sock, onData);
-      });
+      await DIRECT_SOCKETS.waitReadable(sock, want);
+      if (sock.recvQueue.length === 0) {
+        if (sock.error) return -sock.error;  // Return negative errno
+        return null;  // EOF
+      }
+      return DIRECT_SOCKETS.takeFromQueue(sock, length, peek);
+    },
+
+    // Next UDP datagram for recvfrom/recvmsg, or null at EOF / 'EAGAIN'.
+    // With MSG_PEEK the datagram stays queued.
+    async nextDatagram(sock, flags) {
+      if (sock.recvQueue.length === 0) {
+        if (sock._bgReaderDone) return null;
+        if (sock.nonBlocking || (flags & 0x40 /*MSG_DONTWAIT*/)) return 'EAGAIN';
+        await DIRECT_SOCKETS.waitReadable(sock);
+        if (sock.recvQueue.length === 0) return null;
+      }
+      return (flags & 2 /*MSG_PEEK*/) ? sock.recvQueue[0] : sock.recvQueue.shift();
     },
 
-    // Write to Direct Sockets writer.
-    async writeToSocket(sock, data) {
+    // Write to Direct Sockets writer. With TCP_CORK or MSG_MORE the data is
+    // only buffered; otherwise it goes out together with anything buffered.
+    async writeToSocket(sock, data, flags) {
       if (!sock.writer) return -{{{ cDefs.ENOTCONN }}};
       try {
         // Direct Sockets streams don't accept SharedArrayBuffer views
@@ -409,7 +895,20 @@ var DirectSocketsLibrary = {
         if (data.buffer instanceof SharedArrayBuffer) {
           data = new Uint8Array(data);
         }
-        await sock.writer.write(data);
+        var more = !!(flags & 0x8000 /*MSG_MORE*/);
+        if (flags & 0x40 /*MSG_DONTWAIT*/) {
+          // Don't suspend for the write to complete; refuse when full
+          if (!DIRECT_SOCKETS.isWritable(sock)) return -{{{ cDefs.EAGAIN }}};
+          DIRECT_SOCKETS.bufferWrite(sock, data, more);
+          return data.length;
+        }
+        if (sock.cork || more) {
+          DIRECT_SOCKETS.bufferWrite(sock, data, more);
+          return data.length;
+        }
+        sock.sendPending.push(data);
+        sock.sendPendingBytes += data.length;
+        await DIRECT_SOCKETS.flushWrites(sock);
         return data.length;
       } catch (e) {
 
@@ -421,10 +920,172 @@ var DirectSocketsLibrary = {
       }
     },
 
+    // A fresh region of n bytes for outgoing data (never SharedArrayBuffer)
+    allocSend(n) {
+      if (n > DIRECT_SOCKETS.SEND_SLAB / 4) return new Uint8Array(n);
+      if (!DIRECT_SOCKETS.sendSlab || DIRECT_SOCKETS.sendSlabUsed + n > DIRECT_SOCKETS.SEND_SLAB) {
+        DIRECT_SOCKETS.sendSlab = new Uint8Array(DIRECT_SOCKETS.SEND_SLAB);
+        DIRECT_SOCKETS.sendSlabUsed = 0;
+      }
+      var region = DIRECT_SOCKETS.sendSlab.subarray(DIRECT_SOCKETS.sendSlabUsed, DIRECT_SOCKETS.sendSlabUsed + n);
+      DIRECT_SOCKETS.sendSlabUsed += (n + 7) & ~7;
+      return region;
+    },
+
+    // WASI fd_write for socket fds (hooked into libwasi.js by docker_build.sh).
+    // Going through FS would call stream_ops.write once per iovec; here the
+    // iovecs are gathered into one buffer with bulk copies and queued as one
+    // write (one datagram on UDP). Same non-blocking contract as
+    // stream_ops.write. Returns a WASI errno.
+    fdWrite(fd, iov, iovcnt, pnum) {
+      var sock = DIRECT_SOCKETS.getSocket(fd);
+      if (!sock) return {{{ cDefs.EBADF }}};
+      var start = DIRECT_SOCKETS_TRACE.on ? performance.now() : 0;
+      var err = DIRECT_SOCKETS.writev(sock, iov, iovcnt, pnum);
+      if (DIRECT_SOCKETS_STATS.on) DIRECT_SOCKETS_STATS.syscall('fd_write', sock, -err, 0);
+      if (DIRECT_SOCKETS_TRACE.on) DIRECT_SOCKETS_TRACE.syscall('fd_write', fd, -err, start, 0, performance.now());
+      return err;
+    },
+
+    writev(sock, iov, iovcnt, pnum) {
+      if (sock.state === 'connecting') return {{{ cDefs.EAGAIN }}};
+      if (!sock.writer) return {{{ cDefs.ENOTCONN }}};
+      var total = 0;
+      for (var i = 0; i < iovcnt; i++) {
+        total += {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_len}`, 'i32') }}};
+      }
+      var data = DIRECT_SOCKETS.allocSend(total);
+      for (var i = 0, off = 0; i < iovcnt; i++) {
+        var ptr = {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_base}`, '*') }}};
+        var len = {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_len}`, 'i32') }}};
+        data.set(HEAPU8.subarray(ptr, ptr + len), off);
+        off += len;
+      }
+      if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
+        if (total > 0) DIRECT_SOCKETS.bufferWrite(sock, data, false);
+      } else {
+        sock.writeCalls++;
+        DIRECT_SOCKETS_STATS.sent(sock, total, true);
+        sock.writer.write({ data: data }).catch(function(e) {
+          sock.error = {{{ cDefs.EIO }}};
+        });
+      }
+      {{{ makeSetValue('pnum', 0, 'total', '*') }}};
+      return 0;
+    },
+
+    // WASI fd_read for socket fds: one pass over the receive queue, copying
+    // straight into the iovecs. A TCP readv() spans queued chunks; a UDP
+    // one scatters a single datagram and drops what does not fit. Same
+    // non-blocking contract as stream_ops.read. Returns a WASI errno.
+    fdRead(fd, iov, iovcnt, pnum) {
+      var sock = DIRECT_SOCKETS.getSocket(fd);
+      if (!sock) return {{{ cDefs.EBADF }}};
+      var start = DIRECT_SOCKETS_TRACE.on ? performance.now() : 0;
+      var err = DIRECT_SOCKETS.readv(sock, iov, iovcnt, pnum);
+      if (DIRECT_SOCKETS_STATS.on) DIRECT_SOCKETS_STATS.syscall('fd_read', sock, -err, 0);
+      if (DIRECT_SOCKETS_TRACE.on) DIRECT_SOCKETS_TRACE.syscall('fd_read', fd, -err, start, 0, performance.now());
+      return err;
+    },
+
+    readv(sock, iov, iovcnt, pnum) {
+      if (sock.state === 'connecting') return {{{ cDefs.EAGAIN }}};
+      var q = sock.recvQueue;
+      var total = 0;
+      if ((sock.state === 'connected' || sock.state === 'bound') && q.length === 0) {
+        if (sock.error) return sock.error;
+        if (!sock._bgReaderDone) return {{{ cDefs.EAGAIN }}};
+      } else if (q.length > 0 && sock.type !== {{{ cDefs.SOCK_STREAM }}}) {
+        var msg = q.shift().data;
+        for (var i = 0; i < iovcnt && total < msg.length; i++) {
+          var ptr = {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_base}`, '*') }}};
+          var len = {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_len}`, 'i32') }}};
+          var n = Math.min(len, msg.length - total);
+          HEAPU8.set(msg.subarray(total, total + n), ptr);
+          total += n;
+        }
+      } else {
+        for (var i = 0; i < iovcnt && q.length > 0; i++) {
+          var ptr = {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_base}`, '*') }}};
+          var len = {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_len}`, 'i32') }}};
+          for (var filled = 0; filled < len && q.length > 0;) {
+            var chunk = q[0];
+            var n = Math.min(chunk.length, len - filled);
+            HEAPU8.set(chunk.subarray(0, n), ptr + filled);
+            filled += n;
+            if (n === chunk.length) q.shift(); else q[0] = chunk.subarray(n);
+          }
+          total += filled;
+        }
+      }
+      {{{ makeSetValue('pnum', 0, 'total', '*') }}};
+      return 0;
+    },
+
+    // Up to n bytes of a regular file from pos, as a buffer the socket writer
+    // can own. MEMFS files are sliced straight out of the node's backing
+    // array; any other backend is read through its stream_ops. Either way
+    // the data never passes through the Wasm heap. Empty at EOF.
+    readFileChunk(stream, pos, n) {
+      var node = stream.node;
+      if (node.contents && typeof node.usedBytes == 'number') {
+        var end = Math.min(node.usedBytes, pos + n);
+        if (pos >= end) return new Uint8Array(0);
+        var contents = node.contents;
+        return contents.subarray ? contents.slice(pos, end) : new Uint8Array(contents.slice(pos, end));
+      }
+      var buf = new Uint8Array(n);
+      var got = stream.stream_ops.read(stream, buf, 0, n, pos);
+      return buf.subarray(0, got);
+    },
+
+    // Splice count bytes of a file, starting at pos, into a connected TCP
+    // socket (the body of sendfile()). Chunks go to the writer without
+    // waiting for each one to settle. A blocking socket waits whenever the
+    // send buffer is full; a non-blocking one stops there and reports what
+    // it queued, or EAGAIN. Returns the count or a negative errno.
+    async spliceToSocket(sock, stream, pos, count) {
+      if (sock.type !== {{{ cDefs.SOCK_STREAM }}} || sock.state !== 'connected' || !sock.writer) {
+        return -{{{ cDefs.ENOTCONN }}};
+      }
+      // Corked data was written first, so it goes out ahead of the file
+      DIRECT_SOCKETS.flushWrites(sock);
+      var sent = 0, wouldBlock = false;
+      while (sent < count && !sock.error && sock.writer) {
+        if (!DIRECT_SOCKETS.isWritable(sock)) {
+          if (sock.nonBlocking) {
+            wouldBlock = true;
+            break;
+          }
+          await DIRECT_SOCKETS.waitWritable(sock);
+          continue;
+        }
+        var chunk = DIRECT_SOCKETS.readFileChunk(stream, pos + sent, Math.min(count - sent, DIRECT_SOCKETS.SPLICE_CHUNK));
+        if (chunk.length === 0) break;  // EOF
+        DIRECT_SOCKETS.queueWrite(sock, chunk).catch(function(e) {
+          sock.error = {{{ cDefs.EIO }}};
+        });
+        sent += chunk.length;
+      }
+      if (sent === 0) {
+        if (sock.error || !sock.writer) return -{{{ cDefs.EPIPE }}};
+        if (wouldBlock) return -{{{ cDefs.EAGAIN }}};
+      }
+      return sent;
+    },
+
     // Compute poll revents for a socket
     computeRevents(sock, events) {
       var POLLRDNORM = 64, POLLWRNORM = 256;
       var revents = 0;
+      if (sock.state === 'listening') {
+        // A listener is readable while accept() would not block
+        if ((events & {{{ cDefs.POLLIN }}}) && sock.acceptQueue.length > 0) {
+          revents |= {{{ cDefs.POLLIN }}} | POLLRDNORM;
+        }
+        if (sock._acceptDone && sock.acceptQueue.length === 0) revents |= {{{ cDefs.POLLERR }}};
+        return revents;
+      }
       if (events & {{{ cDefs.POLLIN }}}) {
         if (sock.recvQueue.length > 0) {
           revents |= {{{ cDefs.POLLIN }}} | POLLRDNORM;
@@ -433,7 +1094,7 @@ var DirectSocketsLibrary = {
         }
       }
       if (events & {{{ cDefs.POLLOUT }}}) {
-        if ((sock.state === 'connected' || sock.state === 'bound') && sock.writer) {
+        if (DIRECT_SOCKETS.isWritable(sock)) {
           revents |= {{{ cDefs.POLLOUT }}} | POLLWRNORM;
         }
       }
@@ -445,88 +1106,553 @@ var DirectSocketsLibrary = {
       }
       return revents;
     },
+  },
 
-    // Async DNS resolution via DNS-over-HTTPS (DoH)
-    async resolveDNS(hostname, family) {
-      // Check cache first
-      var cached = DIRECT_SOCKETS.dnsCache[hostname];
-      if (cached && cached.expires > Date.now()) return cached.addresses[0];
+  // ---------------------------------------------------------------------------
+  // Timers - precise deadlines for poll/epoll timeouts
+  // ---------------------------------------------------------------------------
 
-      // DoH query via fetch
-      var type = (family === {{{ cDefs.AF_INET6 }}}) ? 'AAAA' : 'A';
-      var typeNum = (type === 'A') ? 1 : 28;
-      try {
-        var resp = await fetch(
-          'https://dns.google/resolve?name=' + encodeURIComponent(hostname) + '&type=' + type,
-          { headers: { 'Accept': 'application/dns-json' } }
-        );
-        var json = await resp.json();
-
-        if (json.Answer && json.Answer.length > 0) {
-          var addresses = json.Answer
-            .filter(function(a) { return a.type === typeNum; })
-            .map(function(a) { return a.data; });
-          if (addresses.length === 0) return null;
-          var ttl = Math.max((json.Answer[0].TTL || 300), 60);
-          DIRECT_SOCKETS.dnsCache[hostname] = {
-            addresses: addresses, expires: Date.now() + ttl * 1000
-          };
-          return addresses[0];
+  // setTimeout is clamped to >= 1ms and to 4ms once nested, which is most of a
+  // QUIC ACK-delay budget. Deadlines are kept in one sorted queue with a single
+  // armed wakeup; timers that expire within SLACK_MS of an existing deadline
+  // join it instead of arming their own.
+  $DIRECT_SOCKETS_TIMERS: {
+    // [{deadline, timers: [...]}] in ascending deadline order
+    queue: [],
+    SLACK_MS: 0.1,
+    // Deadline of the currently armed wakeup; a newer arm() invalidates it
+    armedAt: Infinity,
+    armToken: 0,
+    cell: null,
+
+    // Call cb once, no earlier than ms (fractional) from now
+    add(ms, cb) {
+      var deadline = performance.now() + ms;
+      var q = DIRECT_SOCKETS_TIMERS.queue;
+      var lo = 0, hi = q.length;
+      while (lo < hi) {
+        var mid = (lo + hi) >> 1;
+        if (q[mid].deadline < deadline) lo = mid + 1; else hi = mid;
+      }
+      // Never fire early: join a deadline slightly after ours, or push the
+      // previous one back to ours while its first timer stays within SLACK_MS
+      var slack = DIRECT_SOCKETS_TIMERS.SLACK_MS;
+      var entry = q[lo];
+      if (!entry || entry.deadline > deadline + slack) {
+        if (lo > 0 && deadline - q[lo - 1].first <= slack) {
+          entry = q[lo - 1];
+          entry.deadline = deadline;
+        } else {
+          entry = { deadline: deadline, first: deadline, timers: [] };
+          q.splice(lo, 0, entry);
         }
-      } catch (e) {
-#if SOCKET_DEBUG
-        dbg('direct_sockets: DoH resolution failed for ' + hostname + ': ' + e);
-#endif
       }
-      return null; // NXDOMAIN
+      var timer = { entry: entry, cb: cb };
+      entry.timers.push(timer);
+      DIRECT_SOCKETS_TIMERS.arm();
+      return timer;
     },
-  },
 
-  // ---------------------------------------------------------------------------
-  // Pipes - in-memory pipes for pipe()/socketpair()
-  // ---------------------------------------------------------------------------
+    cancel(timer) {
+      var entry = timer.entry;
+      if (!entry) return;
+      timer.entry = null;
+      var i = entry.timers.indexOf(timer);
+      if (i >= 0) entry.timers.splice(i, 1);
+      if (entry.timers.length === 0) {
+        var j = DIRECT_SOCKETS_TIMERS.queue.indexOf(entry);
+        if (j >= 0) DIRECT_SOCKETS_TIMERS.queue.splice(j, 1);
+      }
+      // Any armed wakeup is left alone; fire() re-arms for what remains
+    },
 
-  $DIRECT_SOCKETS_PIPES__deps: ['$DIRECT_SOCKETS', '$FS'],
-  $DIRECT_SOCKETS_PIPES: {
-    pipes: {},
+    arm() {
+      var q = DIRECT_SOCKETS_TIMERS.queue;
+      if (q.length === 0) return;
+      var deadline = q[0].deadline;
+      if (deadline >= DIRECT_SOCKETS_TIMERS.armedAt) return;
+      DIRECT_SOCKETS_TIMERS.armedAt = deadline;
+      var token = ++DIRECT_SOCKETS_TIMERS.armToken;
+      var wake = function() {
+        if (token !== DIRECT_SOCKETS_TIMERS.armToken) return;
+        DIRECT_SOCKETS_TIMERS.armedAt = Infinity;
+        DIRECT_SOCKETS_TIMERS.fire();
+      };
+      var remaining = Math.max(0, deadline - performance.now());
 
-    // Pipe stream_ops for FS integration (so fd_write/fd_read work on pipe fds)
-    stream_ops: {
-      read(stream, buffer, offset, length, position) {
-        var fd = stream.fd;
-        var data = DIRECT_SOCKETS_PIPES.readPipe(fd, length);
-        if (!data) throw new FS.ErrnoError({{{ cDefs.EAGAIN }}});
-        if (data.length === 0) return 0; // EOF
-        for (var i = 0; i < data.length; i++) {
-          buffer[offset + i] = data[i];
-        }
-        return data.length;
-      },
-      write(stream, buffer, offset, length, position) {
-        var fd = stream.fd;
-        var data = new Uint8Array(length);
-        for (var i = 0; i < length; i++) {
-          data[i] = buffer[offset + i];
+      if (typeof Atomics.waitAsync === 'function' && typeof SharedArrayBuffer !== 'undefined') {
+        // Nobody ever notifies this cell, so the wait always ends by timeout
+        // and is not subject to timer clamping.
+        if (!DIRECT_SOCKETS_TIMERS.cell) {
+          DIRECT_SOCKETS_TIMERS.cell = new Int32Array(new SharedArrayBuffer(4));
         }
-        var result = DIRECT_SOCKETS_PIPES.writePipe(fd, data);
-        if (result < 0) throw new FS.ErrnoError(-result);
-        return result;
-      },
-      poll(stream) {
-        var fd = stream.fd;
-        return DIRECT_SOCKETS_PIPES.computeRevents(fd, 5 /*POLLIN|POLLOUT*/);
-      },
-      close(stream) {
-        DIRECT_SOCKETS_PIPES.closePipeFd(stream.fd);
-      },
+        var res = Atomics.waitAsync(DIRECT_SOCKETS_TIMERS.cell, 0, 0, remaining);
+        if (res.async) res.value.then(wake); else Promise.resolve().then(wake);
+      } else if (globalThis.scheduler && typeof scheduler.postTask === 'function') {
+        // One task at the deadline, a little late if clamped; fire() re-arms
+        // should it run early
+        scheduler.postTask(wake, { delay: remaining });
+      } else {
+        setTimeout(wake, remaining);
+      }
     },
 
-    // Allocate an FS-backed fd for a pipe end
-    allocatePipeFd(name) {
-      DIRECT_SOCKETS.ensureRoot();
-      var node = FS.createNode(DIRECT_SOCKETS.root, name, {{{ cDefs.S_IFIFO }}} | 438 /* 0666 */, 0);
-      var stream = FS.createStream({
-        path: name,
+    fire() {
+      var q = DIRECT_SOCKETS_TIMERS.queue;
+      var now = performance.now();
+      while (q.length > 0 && q[0].deadline <= now) {
+        var timers = q.shift().timers;
+        for (var i = 0; i < timers.length; i++) timers[i].entry = null;
+        for (var i = 0; i < timers.length; i++) timers[i].cb();
+      }
+      DIRECT_SOCKETS_TIMERS.arm();
+    },
+  },
+
+  // ---------------------------------------------------------------------------
+  // Stats - per-socket and global I/O counters
+  // ---------------------------------------------------------------------------
+
+  // Every socket carries a record like `global`; totals survive the socket's
+  // close. Syscalls are counted by the instrumentation added at the bottom of
+  // this file, fd_read/fd_write by DIRECT_SOCKETS.fdRead/fdWrite, but only
+  // while `on` is set: at startup by Module['directSocketsStats'], or by
+  // Module.DirectSockets.enableStats() / emscripten_direct_sockets_stats_enable().
+  // Otherwise a syscall costs one flag check.
+  // Snapshots are read through Module.DirectSockets.stats() or the C function
+  // in <emscripten/direct_sockets_stats.h>, on the thread that owns the
+  // sockets.
+  $DIRECT_SOCKETS_STATS__deps: ['$DIRECT_SOCKETS'],
+  $DIRECT_SOCKETS_STATS: {
+    on: false,
+    global: null,
+    // Syscall names summed into the per-kind counts of the C struct
+    SEND: ['sendto', 'sendmsg', 'sendfile', 'fd_write'],
+    RECV: ['recvfrom', 'recvmsg', 'fd_read'],
+    POLL: ['poll', 'epoll_pwait'],
+
+    create() {
+      return {
+        bytesIn: 0,
+        bytesOut: 0,
+        datagramsIn: 0,
+        datagramsOut: 0,
+        // Syscall name (without __syscall_) -> count
+        calls: {},
+        syscalls: 0,
+        eagain: 0,
+        maxRecvQueue: 0,
+        // Readiness reports that woke a blocked poll()/epoll_wait()
+        pollWakeups: 0,
+        // Wall time spent inside async (JSPI-suspending) syscalls
+        suspendedMs: 0,
+      };
+    },
+
+    getGlobal() {
+      return DIRECT_SOCKETS_STATS.global ||= DIRECT_SOCKETS_STATS.create();
+    },
+
+    // Data handed to the writer: one TCP write or one UDP datagram
+    sent(sock, n, datagram) {
+      var g = DIRECT_SOCKETS_STATS.getGlobal(), s = sock.stats;
+      s.bytesOut += n;
+      g.bytesOut += n;
+      if (datagram) {
+        s.datagramsOut++;
+        g.datagramsOut++;
+      }
+    },
+
+    // A chunk or datagram just pushed onto the receive queue
+    received(sock, n, datagram) {
+      var g = DIRECT_SOCKETS_STATS.getGlobal(), s = sock.stats;
+      s.bytesIn += n;
+      g.bytesIn += n;
+      if (datagram) {
+        s.datagramsIn++;
+        g.datagramsIn++;
+      }
+      var depth = sock.recvQueue.length;
+      if (depth > s.maxRecvQueue) s.maxRecvQueue = depth;
+      if (depth > g.maxRecvQueue) g.maxRecvQueue = depth;
+    },
+
+    wakeup(sock) {
+      sock.stats.pollWakeups++;
+      DIRECT_SOCKETS_STATS.getGlobal().pollWakeups++;
+    },
+
+    // One completed syscall (ret is its return value, -errno on failure);
+    // sock is null when the call is not about a socket
+    syscall(name, sock, ret, ms) {
+      DIRECT_SOCKETS_STATS.record(DIRECT_SOCKETS_STATS.getGlobal(), name, ret, ms);
+      if (sock) DIRECT_SOCKETS_STATS.record(sock.stats, name, ret, ms);
+    },
+
+    record(s, name, ret, ms) {
+      s.syscalls++;
+      s.calls[name] = (s.calls[name] || 0) + 1;
+      if (ret === -{{{ cDefs.EAGAIN }}}) s.eagain++;
+      s.suspendedMs += ms;
+    },
+
+    // Counters plus the queue state right now
+    snapshot(sock) {
+      var s = sock.stats;
+      return Object.assign({}, s, {
+        calls: Object.assign({}, s.calls),
+        fd: sock.fd,
+        type: sock.type === {{{ cDefs.SOCK_STREAM }}} ? 'tcp' : 'udp',
+        state: sock.state,
+        recvQueueDepth: sock.recvQueue.length,
+        bytesInFlight: sock.writeQueued + sock.sendPendingBytes,
+      });
+    },
+
+    // Module.DirectSockets.stats(): global totals with every open socket, or
+    // one socket's snapshot (null if fd is not a socket)
+    stats(fd) {
+      if (fd !== undefined) {
+        var sock = DIRECT_SOCKETS.getSocket(fd);
+        return sock ? DIRECT_SOCKETS_STATS.snapshot(sock) : null;
+      }
+      var g = DIRECT_SOCKETS_STATS.getGlobal();
+      var result = Object.assign({}, g, {
+        calls: Object.assign({}, g.calls),
+        recvQueueDepth: 0,
+        bytesInFlight: 0,
+        sockets: [],
+      });
+      var table = DIRECT_SOCKETS.sockets;
+      for (var i = 0; i < table.length; i++) {
+        if (!table[i]) continue;
+        var snap = DIRECT_SOCKETS_STATS.snapshot(table[i]);
+        result.recvQueueDepth += snap.recvQueueDepth;
+        result.bytesInFlight += snap.bytesInFlight;
+        result.sockets.push(snap);
+      }
+      result.openSockets = result.sockets.length;
+      return result;
+    },
+
+    count(calls, names) {
+      var n = 0;
+      for (var i = 0; i < names.length; i++) n += calls[names[i]] || 0;
+      return n;
+    },
+  },
+
+  // void emscripten_direct_sockets_stats_enable(int on)
+  emscripten_direct_sockets_stats_enable__deps: ['$DIRECT_SOCKETS_STATS'],
+  emscripten_direct_sockets_stats_enable: (on) => {
+    DIRECT_SOCKETS_STATS.on = !!on;
+  },
+
+  // int emscripten_direct_sockets_stats(int fd, direct_sockets_stats_t *out)
+  // Field order matches the struct in direct_sockets_stats.h.
+  emscripten_direct_sockets_stats__deps: ['$DIRECT_SOCKETS_STATS'],
+  emscripten_direct_sockets_stats: (fd, out) => {
+    var s = DIRECT_SOCKETS_STATS.stats(fd < 0 ? undefined : fd);
+    if (!s) return -1;
+    var count = DIRECT_SOCKETS_STATS.count;
+    var values = [
+      s.bytesIn, s.bytesOut, s.datagramsIn, s.datagramsOut,
+      s.syscalls,
+      count(s.calls, DIRECT_SOCKETS_STATS.SEND),
+      count(s.calls, DIRECT_SOCKETS_STATS.RECV),
+      count(s.calls, ['connect']),
+      count(s.calls, ['accept4']),
+      count(s.calls, DIRECT_SOCKETS_STATS.POLL),
+      s.eagain, s.pollWakeups,
+      s.recvQueueDepth, s.maxRecvQueue, s.bytesInFlight,
+      fd < 0 ? s.openSockets : 1,
+    ];
+    for (var i = 0; i < values.length; i++) {
+      {{{ makeSetValue('out', 'i * 8', 'values[i]', 'i64') }}};
+    }
+    {{{ makeSetValue('out', 128, 's.suspendedMs', 'double') }}};
+    return 0;
+  },
+
+  // ---------------------------------------------------------------------------
+  // Trace - opt-in Trace Event recording for Perfetto / chrome://tracing
+  // ---------------------------------------------------------------------------
+
+  // Off unless Module['directSocketsTrace'] is set before startup: true or a
+  // capacity keeps the last N events in a ring, dumped as Trace Event JSON by
+  // Module.DirectSockets.trace(); 'user-timing' additionally emits
+  // performance.measure()/mark(), which Chrome's blink.user_timing category
+  // records next to the CPU profile. Recorded: every syscall (a span from
+  // entry to exit, with a nested 'suspended' span from the point an async one
+  // returns its promise to JSPI until it settles), background reader
+  // deliveries and DNS exchanges. Timestamps are performance.now().
+  $DIRECT_SOCKETS_TRACE__deps: ['pthread_self'],
+  $DIRECT_SOCKETS_TRACE: {
+    on: false,
+    userTiming: false,
+    ring: null,
+    head: 0,
+    CAPACITY: 65536,
+
+    init(option) {
+      if (!option) return;
+      var capacity = typeof option == 'number' ? option : DIRECT_SOCKETS_TRACE.CAPACITY;
+      DIRECT_SOCKETS_TRACE.ring = new Array(capacity);
+      DIRECT_SOCKETS_TRACE.head = 0;
+      DIRECT_SOCKETS_TRACE.userTiming = option === 'user-timing' && typeof performance.measure == 'function';
+      DIRECT_SOCKETS_TRACE.on = true;
+    },
+
+    push(event) {
+      var ring = DIRECT_SOCKETS_TRACE.ring;
+      ring[DIRECT_SOCKETS_TRACE.head++ % ring.length] = event;
+    },
+
+    // Complete ('X') event from start to end (ms)
+    span(name, cat, start, end, args) {
+      DIRECT_SOCKETS_TRACE.push({ ph: 'X', name: name, cat: cat, ts: start, dur: end - start, args: args });
+      if (DIRECT_SOCKETS_TRACE.userTiming) {
+        try { performance.measure(name, { start: start, end: end, detail: args }); } catch (e) {}
+      }
+    },
+
+    instant(name, cat, args) {
+      var ts = performance.now();
+      DIRECT_SOCKETS_TRACE.push({ ph: 'i', name: name, cat: cat, ts: ts, args: args });
+      if (DIRECT_SOCKETS_TRACE.userTiming) {
+        try { performance.mark(name, { startTime: ts, detail: args }); } catch (e) {}
+      }
+    },
+
+    // suspended is when the syscall handed its promise to JSPI (0 if sync)
+    syscall(name, fd, ret, start, suspended, end) {
+      DIRECT_SOCKETS_TRACE.span(name, 'direct_sockets.syscall', start, end, { fd: fd, ret: ret });
+      if (suspended) {
+        DIRECT_SOCKETS_TRACE.span('suspended', 'direct_sockets.jspi', suspended, end, { syscall: name, fd: fd });
+      }
+    },
+
+    // Trace Event JSON ({traceEvents: [...]}) of what the ring holds, oldest
+    // first; clear empties the ring
+    dump(clear) {
+      var ring = DIRECT_SOCKETS_TRACE.ring;
+      if (!ring) return null;
+      var tid = _pthread_self();
+      var events = [
+        { ph: 'M', name: 'process_name', pid: 1, tid: tid, args: { name: 'Direct Sockets' } },
+        { ph: 'M', name: 'thread_name', pid: 1, tid: tid, args: { name: 'syscalls' } },
+      ];
+      var head = DIRECT_SOCKETS_TRACE.head;
+      for (var i = Math.max(0, head - ring.length); i < head; i++) {
+        var e = ring[i % ring.length];
+        var out = { ph: e.ph, name: e.name, cat: e.cat, pid: 1, tid: tid, ts: e.ts * 1000, args: e.args };
+        if (e.ph === 'X') out.dur = e.dur * 1000;
+        else out.s = 't';
+        events.push(out);
+      }
+      if (clear) DIRECT_SOCKETS_TRACE.head = 0;
+      return {
+        traceEvents: events,
+        displayTimeUnit: 'ms',
+        otherData: { timeOrigin: performance.timeOrigin, dropped: Math.max(0, head - ring.length) },
+      };
+    },
+  },
+
+  // ---------------------------------------------------------------------------
+  // Pool - opt-in keep-alive reuse of outbound TCP connections
+  // ---------------------------------------------------------------------------
+
+  // Off unless Module['directSocketsPool'] is set: true for the defaults
+  // below, or an object overriding any of them. close() on a healthy
+  // connected socket parks its TCPSocket here instead of closing it, and the
+  // next connect() with the same (address, port, options) gets it back
+  // without an open. Healthy means connected, no error, the peer has not
+  // closed, and the program read everything it was sent. While parked a
+  // read is kept pending, so a peer FIN (or stray data) evicts the entry at
+  // once. Only safe for protocols where a new "connection" may continue an
+  // old one, such as plaintext HTTP/1.1 keep-alive; never enable it for TLS
+  // or anything with per-connection state.
+  $DIRECT_SOCKETS_POOL__deps: ['$DIRECT_SOCKETS'],
+  $DIRECT_SOCKETS_POOL: {
+    DEFAULTS: { maxIdle: 32, maxPerHost: 6, idleMs: 15000 },
+    // key -> parked entries, oldest first
+    idle: new Map(),
+    idleCount: 0,
+    hits: 0,
+    misses: 0,
+
+    config() {
+      var option = Module['directSocketsPool'];
+      if (!option) return null;
+      return option === true ? DIRECT_SOCKETS_POOL.DEFAULTS : Object.assign({}, DIRECT_SOCKETS_POOL.DEFAULTS, option);
+    },
+
+    // Pool key for connecting sock to dest with opts, or '' when the
+    // connection must not be pooled (pool off, or a pinned local endpoint)
+    key(sock, dest, opts) {
+      if (!DIRECT_SOCKETS_POOL.config() || opts.localAddress || opts.localPort) return '';
+      return dest.addr + '|' + dest.port + '|' + JSON.stringify(opts);
+    },
+
+    // Hand out the most recently parked live connection for key, or null
+    checkout(key) {
+      var list = DIRECT_SOCKETS_POOL.idle.get(key);
+      var entry = list && list.pop();
+      if (list && !list.length) DIRECT_SOCKETS_POOL.idle.delete(key);
+      if (!entry) {
+        DIRECT_SOCKETS_POOL.misses++;
+        return null;
+      }
+      DIRECT_SOCKETS_POOL.idleCount--;
+      clearTimeout(entry.timer);
+      entry.taken = true;
+      // Cancels the liveness read; a chunk it already got is handed on by
+      // the monitor (see park)
+      try { entry.monitor.releaseLock(); } catch (e) {}
+      DIRECT_SOCKETS_POOL.hits++;
+      return entry;
+    },
+
+    // Park sock's connection if it is healthy. Returns true when it was
+    // parked, in which case the caller must not close the TCPSocket.
+    park(sock) {
+      var cfg = DIRECT_SOCKETS_POOL.config();
+      if (!cfg || !sock.poolKey || sock.state !== 'connected' || sock.error || sock._bgReaderDone ||
+          sock.recvQueue.length || !sock.reader || !sock.writer || !sock.tcpSocket) {
+        return false;
+      }
+      // Releasing the lock rejects the background reader's pending read
+      // without consuming anything
+      try { sock.reader.releaseLock(); } catch (e) { return false; }
+      sock.reader = null;
+
+      var entry = {
+        key: sock.poolKey,
+        tcpSocket: sock.tcpSocket,
+        readable: sock.readable,
+        writer: sock.writer,
+        localAddress: sock.localAddress,
+        localPort: sock.localPort,
+        remoteAddress: sock.remoteAddress,
+        remotePort: sock.remotePort,
+        monitor: sock.readable.getReader(),
+        parkedAt: performance.now(),
+        timer: 0,
+        taken: false,
+        // Set by adopt() so a chunk that raced with checkout reaches it
+        sock: null,
+      };
+      sock.tcpSocket = null;
+      sock.writer = null;
+
+      entry.monitor.read().then(function(r) {
+        if (!entry.taken) {
+          DIRECT_SOCKETS_POOL.evict(entry);
+        } else if (!r.done && entry.sock) {
+          entry.sock.recvQueue.unshift(r.value);
+          DIRECT_SOCKETS.signal(entry.sock.readiness);
+        }
+      }, function() {
+        if (!entry.taken) DIRECT_SOCKETS_POOL.evict(entry);
+      });
+      entry.timer = setTimeout(function() { DIRECT_SOCKETS_POOL.evict(entry); }, cfg.idleMs);
+
+      var list = DIRECT_SOCKETS_POOL.idle.get(entry.key);
+      if (!list) DIRECT_SOCKETS_POOL.idle.set(entry.key, list = []);
+      list.push(entry);
+      DIRECT_SOCKETS_POOL.idleCount++;
+      if (list.length > cfg.maxPerHost) DIRECT_SOCKETS_POOL.evict(list[0]);
+      if (DIRECT_SOCKETS_POOL.idleCount > cfg.maxIdle) DIRECT_SOCKETS_POOL.evictOldest();
+      return true;
+    },
+
+    // Give a checked-out connection to sock, as openTCP would a new one
+    adopt(sock, entry) {
+      entry.sock = sock;
+      sock.tcpSocket = entry.tcpSocket;
+      sock.readable = entry.readable;
+      sock.reader = entry.readable.getReader();
+      sock.writer = entry.writer;
+      sock.localAddress = entry.localAddress;
+      sock.localPort = entry.localPort;
+      sock.remoteAddress = entry.remoteAddress;
+      sock.remotePort = entry.remotePort;
+      sock.poolKey = entry.key;
+      sock.state = 'connected';
+    },
+
+    evict(entry) {
+      if (entry.taken) return;
+      entry.taken = true;
+      clearTimeout(entry.timer);
+      var list = DIRECT_SOCKETS_POOL.idle.get(entry.key);
+      var i = list ? list.indexOf(entry) : -1;
+      if (i >= 0) {
+        list.splice(i, 1);
+        if (!list.length) DIRECT_SOCKETS_POOL.idle.delete(entry.key);
+        DIRECT_SOCKETS_POOL.idleCount--;
+      }
+      try { entry.monitor.releaseLock(); } catch (e) {}
+      try { entry.writer.releaseLock(); } catch (e) {}
+      entry.tcpSocket.close().catch(function() {});
+    },
+
+    evictOldest() {
+      var oldest = null;
+      DIRECT_SOCKETS_POOL.idle.forEach(function(list) {
+        if (!oldest || list[0].parkedAt < oldest.parkedAt) oldest = list[0];
+      });
+      if (oldest) DIRECT_SOCKETS_POOL.evict(oldest);
+    },
+  },
+
+  // ---------------------------------------------------------------------------
+  // Pipes - in-memory pipes for pipe()/socketpair()
+  // ---------------------------------------------------------------------------
+
+  $DIRECT_SOCKETS_PIPES__deps: ['$DIRECT_SOCKETS', '$FS'],
+  $DIRECT_SOCKETS_PIPES: {
+    pipes: {},
+
+    // Each direction is a fixed-capacity byte ring. Writes of up to PIPE_BUF
+    // bytes are atomic; F_SETPIPE_SZ resizes the ring like Linux does (page
+    // granularity, power of two, capped at /proc/sys/fs/pipe-max-size).
+    DEFAULT_PIPE_SZ: 65536,
+    PIPE_BUF: 4096,
+    MIN_PIPE_SZ: 4096,
+    MAX_PIPE_SZ: 1048576,
+
+    // Pipe stream_ops for FS integration (non-blocking; the blocking paths
+    // are fdRead/fdWrite below)
+    stream_ops: {
+      read(stream, buffer, offset, length, position) {
+        var res = DIRECT_SOCKETS_PIPES.recv(stream.fd, [{ buf: buffer, off: offset, len: length }], 0x40 /*MSG_DONTWAIT*/);
+        if (typeof res === 'number') throw new FS.ErrnoError(-res);
+        return res.copied;
+      },
+      write(stream, buffer, offset, length, position) {
+        var result = DIRECT_SOCKETS_PIPES.put(DIRECT_SOCKETS_PIPES.pipes[stream.fd],
+                                              [{ buf: buffer, off: offset, len: length }], length);
+        if (result < 0) throw new FS.ErrnoError(-result);
+        return result;
+      },
+      poll(stream) {
+        var fd = stream.fd;
+        return DIRECT_SOCKETS_PIPES.computeRevents(fd, 5 /*POLLIN|POLLOUT*/);
+      },
+      close(stream) {
+        DIRECT_SOCKETS_PIPES.closePipeFd(stream.fd);
+      },
+    },
+
+    // Allocate an FS-backed fd for a pipe end
+    allocatePipeFd(name) {
+      DIRECT_SOCKETS.ensureRoot();
+      var node = FS.createNode(DIRECT_SOCKETS.root, name, {{{ cDefs.S_IFIFO }}} | 438 /* 0666 */, 0);
+      var stream = FS.createStream({
+        path: name,
         node: node,
         flags: {{{ cDefs.O_RDWR }}},
         seekable: false,
@@ -535,24 +1661,101 @@ var DirectSocketsLibrary = {
       return stream.fd;
     },
 
-    createPipe() {
+    createPipe(nonBlocking) {
       var id = DIRECT_SOCKETS.nextId++;
       var readFd = DIRECT_SOCKETS_PIPES.allocatePipeFd('pipe[r' + id + ']');
       var writeFd = DIRECT_SOCKETS_PIPES.allocatePipeFd('pipe[w' + id + ']');
-      var pipe = {
-        buffer: [],          // array of Uint8Array chunks
+      var pipe = DIRECT_SOCKETS_PIPES.createBuffer();
+      DIRECT_SOCKETS_PIPES.register(readFd, { pipe: pipe, end: 'read', otherFd: writeFd, nonBlocking: nonBlocking });
+      DIRECT_SOCKETS_PIPES.register(writeFd, { pipe: pipe, end: 'write', otherFd: readFd, nonBlocking: nonBlocking });
+      return { readFd: readFd, writeFd: writeFd };
+    },
+
+    // One direction of a pipe or socketpair. A message buffer (SOCK_DGRAM /
+    // SOCK_SEQPACKET socketpair) stores each message as a 4-byte length
+    // followed by the payload, so boundaries survive.
+    createBuffer(messages) {
+      return {
+        ring: new Uint8Array(DIRECT_SOCKETS_PIPES.DEFAULT_PIPE_SZ),
+        head: 0,             // offset of the oldest byte in ring
+        length: 0,           // bytes queued, including message headers
+        messages: !!messages,
         closed: { read: false, write: false },
-        pollNotify: null,    // callback for poll integration
+        ends: [],            // fd entries whose readiness depends on this buffer
+        stalled: false,      // a write got EAGAIN since the reader last made room
       };
-      DIRECT_SOCKETS_PIPES.pipes[readFd] = { pipe: pipe, end: 'read', otherFd: writeFd };
-      DIRECT_SOCKETS_PIPES.pipes[writeFd] = { pipe: pipe, end: 'write', otherFd: readFd };
-      return { readFd: readFd, writeFd: writeFd };
+    },
+
+    // The write side reports POLLOUT once one atomic write fits
+    hasRoom(pipe) {
+      return pipe.ring.length - pipe.length >= Math.min(DIRECT_SOCKETS_PIPES.PIPE_BUF, pipe.ring.length);
+    },
+
+    // The reader made room: signal the write side when that crosses the
+    // POLLOUT threshold, or on any room at all after a write got EAGAIN. A
+    // message bigger than PIPE_BUF can fail with POLLOUT already on, and its
+    // writer (blocked, or waiting on an EPOLLET edge) needs every chance.
+    madeRoom(pipe, hadRoom, except) {
+      if (pipe.stalled || (!hadRoom && DIRECT_SOCKETS_PIPES.hasRoom(pipe))) {
+        pipe.stalled = false;
+        DIRECT_SOCKETS_PIPES.notify(pipe, except);
+      }
+    },
+
+    // F_SETPIPE_SZ: resize the ring, keeping queued bytes. Returns the new
+    // capacity or a negative errno.
+    setSize(fd, size) {
+      var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
+      if (!entry || entry.writePipe) return -{{{ cDefs.EBADF }}};
+      if (size > DIRECT_SOCKETS_PIPES.MAX_PIPE_SZ) return -{{{ cDefs.EPERM }}};
+      var cap = DIRECT_SOCKETS_PIPES.MIN_PIPE_SZ;
+      while (cap < size) cap *= 2;
+      var pipe = entry.pipe;
+      if (pipe.length > cap) return -{{{ cDefs.EBUSY }}};
+      if (cap !== pipe.ring.length) {
+        var ring = new Uint8Array(cap);
+        DIRECT_SOCKETS_PIPES.copyOut(pipe, pipe.head, ring, 0, pipe.length);
+        var hadRoom = DIRECT_SOCKETS_PIPES.hasRoom(pipe);
+        pipe.ring = ring;
+        pipe.head = 0;
+        DIRECT_SOCKETS_PIPES.madeRoom(pipe, hadRoom);
+      }
+      return cap;
+    },
+
+    // Copy n ring bytes starting at pos to target[offset..] (no consuming)
+    copyOut(pipe, pos, target, offset, n) {
+      var ring = pipe.ring;
+      var first = Math.min(n, ring.length - pos);
+      target.set(ring.subarray(pos, pos + first), offset);
+      if (first < n) target.set(ring.subarray(0, n - first), offset + first);
+    },
+
+    // Install a pipe fd entry and give it its own readiness object
+    register(fd, entry) {
+      entry.readiness = DIRECT_SOCKETS.createReadiness();
+      entry.pipe.ends.push(entry);
+      if (entry.writePipe) entry.writePipe.ends.push(entry);
+      DIRECT_SOCKETS_PIPES.pipes[fd] = entry;
     },
 
     getPipe(fd) {
       return DIRECT_SOCKETS_PIPES.pipes[fd] || null;
     },
 
+    // Signal every fd attached to this buffer (both ends see state changes),
+    // optionally skipping the fd that caused the change
+    notify(pipe, except) {
+      for (var i = 0; i < pipe.ends.length; i++) {
+        if (pipe.ends[i] !== except) DIRECT_SOCKETS.signal(pipe.ends[i].readiness);
+      }
+    },
+
+    detach(pipe, entry) {
+      var idx = pipe.ends.indexOf(entry);
+      if (idx >= 0) pipe.ends.splice(idx, 1);
+    },
+
     closePipeFd(fd) {
       var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
       if (!entry) return false;
@@ -563,53 +1766,103 @@ var DirectSocketsLibrary = {
         // - our write pipe: mark write closed (we stop writing, partner's reads get EOF)
         entry.pipe.closed.read = true;
         entry.writePipe.closed.write = true;
+        DIRECT_SOCKETS_PIPES.detach(entry.pipe, entry);
+        DIRECT_SOCKETS_PIPES.detach(entry.writePipe, entry);
+        DIRECT_SOCKETS.closeReadiness(entry.readiness);
         // Notify poll waiters
-        if (entry.pipe.pollNotify) {
-          var cb = entry.pipe.pollNotify;
-          entry.pipe.pollNotify = null;
-          cb();
-        }
-        if (entry.writePipe.pollNotify) {
-          var cb = entry.writePipe.pollNotify;
-          entry.writePipe.pollNotify = null;
-          cb();
-        }
+        DIRECT_SOCKETS_PIPES.notify(entry.pipe);
+        DIRECT_SOCKETS_PIPES.notify(entry.writePipe);
       } else {
         entry.pipe.closed[entry.end] = true;
+        DIRECT_SOCKETS_PIPES.detach(entry.pipe, entry);
+        DIRECT_SOCKETS.closeReadiness(entry.readiness);
         // Notify poll waiters on the other end
-        if (entry.pipe.pollNotify) {
-          var cb = entry.pipe.pollNotify;
-          entry.pipe.pollNotify = null;
-          cb();
-        }
+        DIRECT_SOCKETS_PIPES.notify(entry.pipe);
       }
       delete DIRECT_SOCKETS_PIPES.pipes[fd];
       return true;
     },
 
-    readPipe(fd, length) {
-      var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
-      if (!entry) return null;
-      // For regular pipes, only the read end can read
-      // For socketpair fds, the read pipe is in entry.pipe
-      if (entry.end === 'write' && !entry.writePipe) return null;
-      var pipe = entry.pipe; // read from this pipe
-      if (pipe.buffer.length === 0) {
-        if (pipe.closed.write) return new Uint8Array(0); // EOF
-        return null; // would block
-      }
-      var chunk = pipe.buffer[0];
-      if (chunk.length <= length) {
-        pipe.buffer.shift();
-        return chunk;
-      }
-      var result = chunk.slice(0, length);
-      pipe.buffer[0] = chunk.slice(length);
-      return result;
+    // Copy n bytes from source[offset..] into the ring at pos
+    copyIn(pipe, pos, source, offset, n) {
+      var ring = pipe.ring;
+      var first = Math.min(n, ring.length - pos);
+      ring.set(source.subarray(offset, offset + first), pos);
+      if (first < n) ring.set(source.subarray(offset + first, offset + n), 0);
     },
 
-    writePipe(fd, data) {
-      var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
+    // Length of the message whose header starts at pos (little-endian)
+    messageLength(pipe, pos) {
+      var ring = pipe.ring, cap = ring.length;
+      return (ring[pos] | (ring[(pos + 1) % cap] << 8) | (ring[(pos + 2) % cap] << 16) |
+              (ring[(pos + 3) % cap] << 24)) >>> 0;
+    },
+
+    // Segments are {buf, off, len}; buf null means the Wasm heap, looked up
+    // at copy time because memory growth replaces HEAPU8 while a blocking
+    // call waits. iovec arrays map onto them without copying.
+    iovecs(iov, iovcnt) {
+      var segs = [];
+      for (var i = 0; i < iovcnt; i++) {
+        segs.push({
+          buf: null,
+          off: {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_base}`, '*') }}},
+          len: {{{ makeGetValue('iov', `(${C_STRUCTS.iovec.__size__} * i) + ${C_STRUCTS.iovec.iov_len}`, 'i32') }}},
+        });
+      }
+      return segs;
+    },
+
+    // Segments past the first `skip` bytes
+    advance(segs, skip) {
+      var out = [];
+      for (var i = 0; i < segs.length; i++) {
+        var seg = segs[i];
+        if (skip >= seg.len) { skip -= seg.len; continue; }
+        out.push({ buf: seg.buf, off: seg.off + skip, len: seg.len - skip });
+        skip = 0;
+      }
+      return out;
+    },
+
+    // Move queued data straight from the ring into segments. A message
+    // buffer delivers one message and drops whatever does not fit; a stream
+    // buffer fills the segments in order. Returns {copied, length}, where
+    // length is the full message size (streams: copied), or null when empty.
+    take(entry, segs, peek) {
+      var pipe = entry.pipe;
+      if (pipe.length === 0) return null;
+      var cap = pipe.ring.length;
+      var pos = pipe.head;
+      var avail = pipe.length, consumed;
+      if (pipe.messages) {
+        avail = DIRECT_SOCKETS_PIPES.messageLength(pipe, pos);
+        pos = (pos + 4) % cap;
+        consumed = 4 + avail;
+      }
+      var copied = 0;
+      for (var i = 0; i < segs.length && copied < avail; i++) {
+        var n = Math.min(segs[i].len, avail - copied);
+        DIRECT_SOCKETS_PIPES.copyOut(pipe, pos, segs[i].buf || HEAPU8, segs[i].off, n);
+        pos = (pos + n) % cap;
+        copied += n;
+      }
+      if (!pipe.messages) avail = consumed = copied;
+      if (!peek && consumed > 0) {
+        var hadRoom = DIRECT_SOCKETS_PIPES.hasRoom(pipe);
+        pipe.head = (pipe.head + consumed) % cap;
+        pipe.length -= consumed;
+        if (pipe.length === 0) pipe.head = 0;
+        DIRECT_SOCKETS_PIPES.madeRoom(pipe, hadRoom, entry);
+      }
+      return { copied: copied, length: avail };
+    },
+
+    // Non-blocking write of `total` bytes of segments. Stream buffers follow
+    // pipe(7): up to PIPE_BUF bytes go in whole or not at all, larger writes
+    // take what fits. A message buffer takes the whole message or nothing.
+    // Returns the count, -EAGAIN when nothing could be written, or -errno.
+    put(entry, segs, total) {
       if (!entry) return -{{{ cDefs.EBADF }}};
       // For regular pipes, only the write end can write
       // For socketpair fds, write goes to entry.writePipe
@@ -622,14 +1875,171 @@ var DirectSocketsLibrary = {
         return -{{{ cDefs.EBADF }}}; // read end of a regular pipe
       }
       if (targetPipe.closed.read) return -{{{ cDefs.EPIPE }}};
-      targetPipe.buffer.push(new Uint8Array(data));
+
+      var cap = targetPipe.ring.length;
+      var space = cap - targetPipe.length;
+      var pos = (targetPipe.head + targetPipe.length) % cap;
+      var n;
+      if (targetPipe.messages) {
+        if (total + 4 > cap) return -{{{ cDefs.EMSGSIZE }}};
+        if (total + 4 > space) {
+          targetPipe.stalled = true;
+          return -{{{ cDefs.EAGAIN }}};
+        }
+        var ring = targetPipe.ring;
+        for (var i = 0; i < 4; i++) ring[(pos + i) % cap] = (total >>> (8 * i)) & 0xFF;
+        pos = (pos + 4) % cap;
+        n = total;
+        targetPipe.length += 4;
+      } else {
+        if (total === 0) return 0;
+        var atomic = total <= DIRECT_SOCKETS_PIPES.PIPE_BUF;
+        if (space === 0 || (atomic && space < total)) {
+          targetPipe.stalled = true;
+          return -{{{ cDefs.EAGAIN }}};
+        }
+        n = Math.min(total, space);
+      }
+      for (var i = 0, left = n; i < segs.length && left > 0; i++) {
+        var len = Math.min(segs[i].len, left);
+        DIRECT_SOCKETS_PIPES.copyIn(targetPipe, pos, segs[i].buf || HEAPU8, segs[i].off, len);
+        pos = (pos + len) % cap;
+        left -= len;
+      }
+      targetPipe.length += n;
       // Notify poll waiters
-      if (targetPipe.pollNotify) {
-        var cb = targetPipe.pollNotify;
-        targetPipe.pollNotify = null;
-        cb();
+      DIRECT_SOCKETS_PIPES.notify(targetPipe);
+      return n;
+    },
+
+    readPipe(fd, length) {
+      var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
+      if (!entry) return null;
+      var out = new Uint8Array(length);
+      var res = DIRECT_SOCKETS_PIPES.recv(fd, [{ buf: out, off: 0, len: length }], 0x40 /*MSG_DONTWAIT*/);
+      if (typeof res === 'number') return null; // would block
+      return out.subarray(0, res.copied);         // empty is EOF
+    },
+
+    writePipe(fd, data) {
+      return DIRECT_SOCKETS_PIPES.put(DIRECT_SOCKETS_PIPES.pipes[fd], [{ buf: data, off: 0, len: data.length }], data.length);
+    },
+
+    // Resolve on the next readiness change of a pipe fd
+    wait(entry) {
+      return new Promise((resolve) => {
+        var wake = () => {
+          DIRECT_SOCKETS.unsubscribe(entry.readiness, wake);
+          resolve();
+        };
+        DIRECT_SOCKETS.subscribe(entry.readiness, wake);
+      });
+    },
+
+    // recv()/read() on a pipe or socketpair fd, honoring MSG_PEEK,
+    // MSG_DONTWAIT and (streams) MSG_WAITALL. Returns {copied, length}
+    // ({0, 0} at EOF) or a negative errno, or a Promise of either when a
+    // blocking fd has to wait for a writer.
+    recv(fd, segs, flags) {
+      var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
+      if (!entry) return -{{{ cDefs.EBADF }}};
+      // For regular pipes, only the read end can read
+      // For socketpair fds, the read pipe is in entry.pipe
+      if (entry.end === 'write' && !entry.writePipe) return -{{{ cDefs.EBADF }}};
+      var pipe = entry.pipe;
+      var block = !entry.nonBlocking && !(flags & 0x40 /*MSG_DONTWAIT*/);
+      var res = DIRECT_SOCKETS_PIPES.take(entry, segs, flags & 2 /*MSG_PEEK*/);
+      if (!res) {
+        if (pipe.closed.write) return { copied: 0, length: 0 }; // EOF
+        if (!block) return -{{{ cDefs.EAGAIN }}};
+        return DIRECT_SOCKETS_PIPES.wait(entry).then(() => DIRECT_SOCKETS_PIPES.recv(fd, segs, flags));
       }
-      return data.length;
+      var want = segs.reduce((n, seg) => n + seg.len, 0);
+      if ((flags & 0x100 /*MSG_WAITALL*/) && !(flags & 2) && block && !pipe.messages &&
+          res.copied < want && !pipe.closed.write) {
+        var rest = DIRECT_SOCKETS_PIPES.advance(segs, res.copied);
+        return DIRECT_SOCKETS_PIPES.wait(entry).then(() => DIRECT_SOCKETS_PIPES.recv(fd, rest, flags)).then((more) => {
+          var n = res.copied + (typeof more === 'number' ? 0 : more.copied);
+          return { copied: n, length: n };
+        });
+      }
+      return res;
+    },
+
+    // send()/write() on a pipe or socketpair fd. Returns the count or a
+    // negative errno, or a Promise of one when a blocking fd waits for room.
+    send(fd, segs, flags) {
+      var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
+      if (!entry) return -{{{ cDefs.EBADF }}};
+      var total = segs.reduce((n, seg) => n + seg.len, 0);
+      var rc = DIRECT_SOCKETS_PIPES.put(entry, segs, total);
+      var done = rc > 0 ? rc : 0;
+      if (entry.nonBlocking || (flags & 0x40 /*MSG_DONTWAIT*/) ||
+          (rc < 0 && rc !== -{{{ cDefs.EAGAIN }}}) || done === total) {
+        return rc;
+      }
+      // Blocking and not all written: copy the rest off the heap (memory may
+      // grow while we wait) and finish once the reader makes room
+      var rest = new Uint8Array(total - done);
+      for (var i = 0, segsLeft = DIRECT_SOCKETS_PIPES.advance(segs, done), off = 0; i < segsLeft.length; i++) {
+        var seg = segsLeft[i];
+        rest.set((seg.buf || HEAPU8).subarray(seg.off, seg.off + seg.len), off);
+        off += seg.len;
+      }
+      return (async () => {
+        var off = 0;
+        while (off < rest.length) {
+          await DIRECT_SOCKETS_PIPES.wait(entry);
+          rc = DIRECT_SOCKETS_PIPES.put(entry, [{ buf: rest, off: off, len: rest.length - off }], rest.length - off);
+          if (rc === -{{{ cDefs.EAGAIN }}}) continue;
+          if (rc < 0) return done + off > 0 ? done + off : rc;
+          off += rc;
+          // A message goes in whole, so rc covered all of it
+        }
+        return done + off;
+      })();
+    },
+
+    // WASI fd_read / fd_write for pipe and socketpair fds (hooked into
+    // libwasi.js by docker_build.sh). Return a WASI errno, or a Promise of
+    // one when a blocking fd has to wait.
+    fdRead(fd, iov, iovcnt, pnum) {
+      var done = (res) => {
+        if (typeof res === 'number') return -res;
+        {{{ makeSetValue('pnum', 0, 'res.copied', '*') }}};
+        return 0;
+      };
+      var res = DIRECT_SOCKETS_PIPES.recv(fd, DIRECT_SOCKETS_PIPES.iovecs(iov, iovcnt), 0);
+      return res instanceof Promise ? res.then(done) : done(res);
+    },
+
+    // The iovecs are written as one message, so a writev() of up to
+    // PIPE_BUF bytes stays atomic
+    fdWrite(fd, iov, iovcnt, pnum) {
+      if (!DIRECT_SOCKETS_PIPES.pipes[fd]) return {{{ cDefs.EBADF }}};
+      var done = (rc) => {
+        if (rc < 0) return -rc;
+        {{{ makeSetValue('pnum', 0, 'rc', '*') }}};
+        return 0;
+      };
+      var rc = DIRECT_SOCKETS_PIPES.send(fd, DIRECT_SOCKETS_PIPES.iovecs(iov, iovcnt), 0);
+      return rc instanceof Promise ? rc.then(done) : done(rc);
+    },
+
+    // send()/recv() family on a socketpair fd; the ends of pipe2() are not
+    // sockets. The peer is unnamed, so callers report an empty address.
+    socketSend(fd, segs, flags) {
+      var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
+      if (!entry) return -{{{ cDefs.EBADF }}};
+      if (!entry.writePipe) return -{{{ cDefs.ENOTSOCK }}};
+      return DIRECT_SOCKETS_PIPES.send(fd, segs, flags);
+    },
+
+    socketRecv(fd, segs, flags) {
+      var entry = DIRECT_SOCKETS_PIPES.pipes[fd];
+      if (!entry) return -{{{ cDefs.EBADF }}};
+      if (!entry.writePipe) return -{{{ cDefs.ENOTSOCK }}};
+      return DIRECT_SOCKETS_PIPES.recv(fd, segs, flags);
     },
 
     computeRevents(fd, events) {
@@ -643,22 +2053,22 @@ var DirectSocketsLibrary = {
         var readPipe = entry.pipe;
         var writePipe = entry.writePipe;
         if (events & {{{ cDefs.POLLIN }}}) {
-          if (readPipe.buffer.length > 0) revents |= {{{ cDefs.POLLIN }}} | POLLRDNORM;
+          if (readPipe.length > 0) revents |= {{{ cDefs.POLLIN }}} | POLLRDNORM;
         }
-        if (readPipe.closed.write && readPipe.buffer.length === 0) revents |= {{{ cDefs.POLLHUP }}};
+        if (readPipe.closed.write && readPipe.length === 0) revents |= {{{ cDefs.POLLHUP }}};
         if (events & {{{ cDefs.POLLOUT }}}) {
-          if (!writePipe.closed.read) revents |= {{{ cDefs.POLLOUT }}} | POLLWRNORM;
+          if (!writePipe.closed.read && DIRECT_SOCKETS_PIPES.hasRoom(writePipe)) revents |= {{{ cDefs.POLLOUT }}} | POLLWRNORM;
         }
       } else if (entry.end === 'read') {
         var pipe = entry.pipe;
         if (events & {{{ cDefs.POLLIN }}}) {
-          if (pipe.buffer.length > 0) revents |= {{{ cDefs.POLLIN }}} | POLLRDNORM;
+          if (pipe.length > 0) revents |= {{{ cDefs.POLLIN }}} | POLLRDNORM;
         }
-        if (pipe.closed.write && pipe.buffer.length === 0) revents |= {{{ cDefs.POLLHUP }}};
+        if (pipe.closed.write && pipe.length === 0) revents |= {{{ cDefs.POLLHUP }}};
       } else {
         var pipe = entry.pipe;
         if (events & {{{ cDefs.POLLOUT }}}) {
-          if (!pipe.closed.read) revents |= {{{ cDefs.POLLOUT }}} | POLLWRNORM;
+          if (!pipe.closed.read && DIRECT_SOCKETS_PIPES.hasRoom(pipe)) revents |= {{{ cDefs.POLLOUT }}} | POLLWRNORM;
         }
         if (pipe.closed.read) revents |= {{{ cDefs.POLLERR }}};
       }
@@ -666,12 +2076,170 @@ var DirectSocketsLibrary = {
     },
   },
 
+  // ---------------------------------------------------------------------------
+  // epoll - persistent interest lists with a per-instance ready list
+  // ---------------------------------------------------------------------------
+
+  $DIRECT_SOCKETS_EPOLL__deps: ['$DIRECT_SOCKETS', '$DIRECT_SOCKETS_PIPES', '$DIRECT_SOCKETS_STATS', '$FS', '__errno_location'],
+  $DIRECT_SOCKETS_EPOLL: {
+    // epfd -> epoll instance
+    instances: {},
+
+    // struct epoll_event { uint32_t events; epoll_data_t data; } is not packed
+    // on wasm32, so the 64-bit data union sits at offset 8 and the struct is 16 bytes.
+    EVENT_SIZE: 16,
+    EPOLLRDHUP: 0x2000,
+    EPOLLONESHOT: 1 << 30,
+    EPOLLET: 1 << 31,
+
+    stream_ops: {
+      read(stream, buffer, offset, length, position) {
+        throw new FS.ErrnoError({{{ cDefs.EINVAL }}});
+      },
+      write(stream, buffer, offset, length, position) {
+        throw new FS.ErrnoError({{{ cDefs.EINVAL }}});
+      },
+      poll(stream) {
+        var ep = DIRECT_SOCKETS_EPOLL.instances[stream.fd];
+        return (ep && ep.ready.length > 0) ? {{{ cDefs.POLLIN }}} : 0;
+      },
+      close(stream) {
+        DIRECT_SOCKETS_EPOLL.close(stream.fd);
+      },
+    },
+
+    create() {
+      DIRECT_SOCKETS.ensureRoot();
+      var name = 'epoll[' + (DIRECT_SOCKETS.nextId++) + ']';
+      var node = FS.createNode(DIRECT_SOCKETS.root, name, {{{ cDefs.S_IFREG }}} | 384 /* 0600 */, 0);
+      var stream = FS.createStream({
+        path: name,
+        node: node,
+        flags: {{{ cDefs.O_RDWR }}},
+        seekable: false,
+        stream_ops: DIRECT_SOCKETS_EPOLL.stream_ops,
+      });
+      var ep = {
+        fd: stream.fd,
+        interest: new Map(),  // watched fd -> item
+        ready: [],            // items whose readiness changed since last harvest
+        readiness: DIRECT_SOCKETS.createReadiness(),  // signalled when ready grows
+      };
+      DIRECT_SOCKETS_EPOLL.instances[ep.fd] = ep;
+      return ep;
+    },
+
+    getInstance(fd) {
+      return DIRECT_SOCKETS_EPOLL.instances[fd] || null;
+    },
+
+    // Convert a -errno syscall result into the libc convention (-1 + errno).
+    // Emscripten's libc does not build musl's epoll.c, so the epoll_*
+    // entry points below are provided from JS and must set errno themselves.
+    ret(rc) {
+      if (rc >= 0) return rc;
+      {{{ makeSetValue('___errno_location()', 0, '-rc', 'i32') }}};
+      return -1;
+    },
+
+    close(fd) {
+      var ep = DIRECT_SOCKETS_EPOLL.instances[fd];
+      if (!ep) return false;
+      ep.interest.forEach((item) => DIRECT_SOCKETS_EPOLL.unlink(item));
+      ep.interest.clear();
+      ep.ready = [];
+      delete DIRECT_SOCKETS_EPOLL.instances[fd];
+      DIRECT_SOCKETS.closeReadiness(ep.readiness);
+      return true;
+    },
+
+    // Subscribe an interest item to its fd's readiness object. Every
+    // signal pushes the item onto the ready list (once) and wakes waiters.
+    link(item) {
+      item.notify = function() {
+        if (item.removed) return;
+        if (!item.queued) {
+          item.queued = true;
+          item.ep.ready.push(item);
+        }
+        DIRECT_SOCKETS.signal(item.ep.readiness);
+      };
+      DIRECT_SOCKETS.subscribe(item.rd, item.notify);
+    },
+
+    unlink(item) {
+      item.removed = true;
+      DIRECT_SOCKETS.unsubscribe(item.rd, item.notify);
+    },
+
+    itemRevents(item) {
+      var POLLRDNORM = 64, POLLWRNORM = 256;
+      var mask = item.events & ({{{ cDefs.POLLIN | cDefs.POLLOUT }}} | 2 /*POLLPRI*/ | POLLRDNORM | POLLWRNORM);
+      if (!(item.events & ~(DIRECT_SOCKETS_EPOLL.EPOLLET | DIRECT_SOCKETS_EPOLL.EPOLLONESHOT))) return 0;
+      var revents = item.sock
+        ? DIRECT_SOCKETS.computeRevents(item.sock, mask)
+        : DIRECT_SOCKETS_PIPES.computeRevents(item.fd, mask);
+      if (revents & {{{ cDefs.POLLHUP }}}) revents |= item.events & DIRECT_SOCKETS_EPOLL.EPOLLRDHUP;
+      // EPOLLERR/EPOLLHUP are always reported, other bits only when requested
+      return revents & (item.events | {{{ cDefs.POLLERR | cDefs.POLLHUP }}});
+    },
+
+    // Drain the ready list into the caller's epoll_event array. Only items
+    // whose readiness changed are visited, so the cost is O(ready) rather
+    // than O(interest). Level-triggered items that are still ready go back
+    // on the list; edge-triggered ones wait for the next notification.
+    // woken is set when a blocked epoll_wait is being woken (for stats).
+    harvest(ep, events, maxevents, woken) {
+      var list = ep.ready;
+      var requeue = [];
+      var n = 0;
+      var i = 0;
+      ep.ready = [];
+      for (; i < list.length && n < maxevents; i++) {
+        var item = list[i];
+        item.queued = false;
+        if (item.removed) continue;
+        if (item.rd.closed) {
+          // close() on Linux implicitly removes the fd from every epoll set
+          DIRECT_SOCKETS_EPOLL.unlink(item);
+          if (ep.interest.get(item.fd) === item) ep.interest.delete(item.fd);
+          continue;
+        }
+        // Edge-triggered: nothing new since this item was last reported
+        if ((item.events & DIRECT_SOCKETS_EPOLL.EPOLLET) && item.seenGen === item.rd.gen) continue;
+        var revents = DIRECT_SOCKETS_EPOLL.itemRevents(item);
+        if (!revents) continue;
+
+        var ptr = events + n * DIRECT_SOCKETS_EPOLL.EVENT_SIZE;
+        {{{ makeSetValue('ptr', 0, 'revents', 'i32') }}};
+        {{{ makeSetValue('ptr', 8, 'item.dataLo', 'i32') }}};
+        {{{ makeSetValue('ptr', 12, 'item.dataHi', 'i32') }}};
+        item.seenGen = item.rd.gen;
+        n++;
+        if (woken && item.sock) DIRECT_SOCKETS_STATS.wakeup(item.sock);
+
+        if (item.events & DIRECT_SOCKETS_EPOLL.EPOLLONESHOT) {
+          // Disabled until re-armed with EPOLL_CTL_MOD
+          item.events = 0;
+        } else if (!(item.events & DIRECT_SOCKETS_EPOLL.EPOLLET)) {
+          item.queued = true;
+          requeue.push(item);
+        }
+      }
+      // Items we had no room for keep their place ahead of the requeued ones
+      for (; i < list.length; i++) ep.ready.push(list[i]);
+      for (var j = 0; j < requeue.length; j++) ep.ready.push(requeue[j]);
+      return n;
+    },
+  },
+
   // ---------------------------------------------------------------------------
   // Syscall implementations
   // ---------------------------------------------------------------------------
 
   __syscall_socket: (domain, type, protocol) => {
-    // Strip flags that don't apply in single-process context
+    // SOCK_CLOEXEC doesn't apply in single-process context
+    var nonBlocking = !!(type & {{{ cDefs.SOCK_NONBLOCK }}});
     type &= ~({{{ cDefs.SOCK_CLOEXEC | cDefs.SOCK_NONBLOCK }}});
 
     // Validate family
@@ -693,6 +2261,7 @@ var DirectSocketsLibrary = {
     }
 
     var sock = DIRECT_SOCKETS.createSocketState(domain, type, protocol);
+    sock.nonBlocking = nonBlocking;
 
 #if SOCKET_DEBUG
     dbg(`direct_sockets: socket(${domain}, ${type}, ${protocol}) -> fd ${sock.fd}`);
@@ -705,7 +2274,8 @@ var DirectSocketsLibrary = {
   __syscall_connect: async (fd, addr, addrlen) => {
     var sock = DIRECT_SOCKETS.getSocket(fd);
     if (!sock) return -{{{ cDefs.EBADF }}};
-    if (sock.state === 'connected' || sock.state === 'connecting') return -{{{ cDefs.EISCONN }}};
+    if (sock.state === 'connected') return -{{{ cDefs.EISCONN }}};
+    if (sock.state === 'connecting') return -{{{ cDefs.EALREADY }}};
     if (sock.state !== 'created' && sock.state !== 'bound') return -{{{ cDefs.EINVAL }}};
 
     var dest = DIRECT_SOCKETS.parseSockaddr(addr, addrlen);
@@ -715,79 +2285,71 @@ var DirectSocketsLibrary = {
     dbg(`direct_sockets: connect(fd=${fd}, addr=${dest.addr}, port=${dest.port})`);
 #endif
 
-    sock.state = 'connecting';
-
-    try {
-      if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
-        // TCP connect - pass local endpoint from prior bind() if present
-        if (typeof TCPSocket === 'undefined') return -{{{ cDefs.ENOSYS }}};
-        var opts = DIRECT_SOCKETS.buildTCPOptions(sock);
-        if (sock.localAddress && sock.localAddress !== '0.0.0.0') {
-          opts.localAddress = sock.localAddress;
-        }
-        if (sock.localPort) {
-          opts.localPort = sock.localPort;
-        }
-        var tcpSocket = new TCPSocket(dest.addr, dest.port, opts);
-        var openInfo = await tcpSocket.opened;
-
-        sock.tcpSocket = tcpSocket;
-        sock.reader = openInfo.readable.getReader();
-        sock.writer = openInfo.writable.getWriter();
-        sock.remoteAddress = openInfo.remoteAddress || dest.addr;
-        sock.remotePort = openInfo.remotePort || dest.port;
-        sock.localAddress = openInfo.localAddress || sock.localAddress || '0.0.0.0';
-        sock.localPort = openInfo.localPort || sock.localPort || 0;
-        sock.state = 'connected';
-
-        // Start background reader for poll/non-blocking support
-        DIRECT_SOCKETS.startBackgroundReader(sock);
-
-      } else {
-        // UDP "connect" - creates a connected-mode UDPSocket
-        // Close existing UDP socket from prior bind() to avoid leaking
-        if (sock.udpSocket) {
-          try {
-            if (sock.reader) { sock.reader.releaseLock(); sock.reader = null; }
-            if (sock.writer) { sock.writer.releaseLock(); sock.writer = null; }
-            await sock.udpSocket.close();
-          } catch (e) {}
-          sock.udpSocket = null;
+    if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
+      if (typeof TCPSocket === 'undefined') return -{{{ cDefs.ENOSYS }}};
+      sock.state = 'connecting';
+      var pending = DIRECT_SOCKETS.openTCP(sock, dest);
+      if (!sock.nonBlocking) return pending;
+      // Keep opening in the background. Completion is reported through
+      // POLLOUT, failure through POLLERR + getsockopt(SO_ERROR).
+      pending.then(function(rc) {
+        if (rc < 0 && sock.state !== 'closed') {
+          sock.error = -rc;
+          DIRECT_SOCKETS.signal(sock.readiness);
         }
+      });
+      return -{{{ cDefs.EINPROGRESS }}};
+    }
 
-        if (typeof UDPSocket === 'undefined') return -{{{ cDefs.ENOSYS }}};
-        var opts = DIRECT_SOCKETS.buildUDPOptions(sock);
-        opts.remoteAddress = dest.addr;
-        opts.remotePort = dest.port;
-        // Honor local endpoint from prior bind()
-        if (sock.localAddress && sock.localAddress !== '0.0.0.0') {
-          opts.localAddress = sock.localAddress;
-        }
-        if (sock.localPort) {
-          opts.localPort = sock.localPort;
-        }
-        var udpSocket = new UDPSocket(opts);
-        var openInfo = await udpSocket.opened;
+    sock.state = 'connecting';
 
-        sock.udpSocket = udpSocket;
-        sock.reader = openInfo.readable.getReader();
-        sock.writer = openInfo.writable.getWriter();
-        DIRECT_SOCKETS.attachMulticastController(sock, openInfo);
-        sock.remoteAddress = openInfo.remoteAddress || dest.addr;
-        sock.remotePort = openInfo.remotePort || dest.port;
-        sock.localAddress = openInfo.localAddress || sock.localAddress || '0.0.0.0';
-        sock.localPort = openInfo.localPort || sock.localPort || 0;
-        sock.state = 'connected';
+    try {
+      // UDP "connect" - creates a connected-mode UDPSocket
+      // Close existing UDP socket from prior bind() to avoid leaking
+      if (sock.udpSocket) {
+        try {
+          if (sock.reader) { sock.reader.releaseLock(); sock.reader = null; }
+          if (sock.writer) { sock.writer.releaseLock(); sock.writer = null; }
+          await sock.udpSocket.close();
+        } catch (e) {}
+        sock.udpSocket = null;
+      }
 
-        // Start background reader for poll/non-blocking support
-        DIRECT_SOCKETS.startBackgroundReader(sock);
+      if (typeof UDPSocket === 'undefined') return -{{{ cDefs.ENOSYS }}};
+      var opts = DIRECT_SOCKETS.buildUDPOptions(sock);
+      opts.remoteAddress = dest.addr;
+      opts.remotePort = dest.port;
+      // Honor local endpoint from prior bind()
+      if (sock.localAddress && sock.localAddress !== '0.0.0.0') {
+        opts.localAddress = sock.localAddress;
       }
+      if (sock.localPort) {
+        opts.localPort = sock.localPort;
+      }
+      var udpSocket = new UDPSocket(opts);
+      var openInfo = await udpSocket.opened;
+
+      sock.udpSocket = udpSocket;
+      sock.reader = openInfo.readable.getReader();
+      sock.writer = openInfo.writable.getWriter();
+      DIRECT_SOCKETS.attachMulticastController(sock, openInfo);
+      sock.remoteAddress = openInfo.remoteAddress || dest.addr;
+      sock.remotePort = openInfo.remotePort || dest.port;
+      sock.localAddress = openInfo.localAddress || sock.localAddress || '0.0.0.0';
+      sock.localPort = openInfo.localPort || sock.localPort || 0;
+      sock.connectedDest = dest;
+      sock.state = 'connected';
+
+      // Start background reader for poll/non-blocking support
+      DIRECT_SOCKETS.startBackgroundReader(sock);
+      DIRECT_SOCKETS.signal(sock.readiness);
     } catch (e) {
 #if SOCKET_DEBUG
       dbg(`direct_sockets: connect error: ${e}`);
 #endif
       // Restore prior state: if socket was bound, keep it bound (important for UDP)
       sock.state = (sock.localAddress || sock.localPort) ? 'bound' : 'created';
+      DIRECT_SOCKETS.signal(sock.readiness);
       if (e.name === 'NotAllowedError') return -{{{ cDefs.EACCES }}};
       return -{{{ cDefs.ECONNREFUSED }}};
     }
@@ -870,9 +2432,11 @@ var DirectSocketsLibrary = {
 
       sock.tcpServer = tcpServer;
       sock.acceptReader = openInfo.readable.getReader();
+      sock.acceptBacklog = Math.min(Math.max(backlog, 1), DIRECT_SOCKETS.SOMAXCONN);
       sock.localAddress = openInfo.localAddress || sock.localAddress;
       sock.localPort = openInfo.localPort || sock.localPort;
       sock.state = 'listening';
+      DIRECT_SOCKETS.startAcceptLoop(sock);
     } catch (e) {
 #if SOCKET_DEBUG
       dbg(`direct_sockets: listen error: ${e}`);
@@ -895,138 +2459,109 @@ var DirectSocketsLibrary = {
     dbg(`direct_sockets: accept4(fd=${fd})`);
 #endif
 
-    try {
-      var { value: acceptedTcpSocket, done } = await sock.acceptReader.read();
-      if (done || !acceptedTcpSocket) return -{{{ cDefs.ECONNABORTED }}};
-
-      // acceptedTcpSocket is a TCPSocket instance from the server's readable stream
-      var openInfo = await acceptedTcpSocket.opened;
-
-      // Create a new socket state for the accepted connection
-      var newSock = DIRECT_SOCKETS.createSocketState(sock.family, sock.type, sock.protocol);
-      newSock.tcpSocket = acceptedTcpSocket;
-      newSock.reader = openInfo.readable.getReader();
-      newSock.writer = openInfo.writable.getWriter();
-      newSock.remoteAddress = openInfo.remoteAddress || '0.0.0.0';
-      newSock.remotePort = openInfo.remotePort || 0;
-      newSock.localAddress = openInfo.localAddress || sock.localAddress;
-      newSock.localPort = openInfo.localPort || sock.localPort;
-      newSock.state = 'connected';
-
-      // Start background reader for poll/non-blocking support
-      DIRECT_SOCKETS.startBackgroundReader(newSock);
-
-      // Write peer address back if requested
-      if (addr) {
-        var errno = writeSockaddr(addr, sock.family, DNS.lookup_name(newSock.remoteAddress), newSock.remotePort, addrlen);
-        if (errno) {
+    // Connections are prefetched by the accept loop; wait only when none is
+    // queued and the listener is blocking
+    if (sock.acceptQueue.length === 0) {
+      if (sock._acceptDone) return -{{{ cDefs.ECONNABORTED }}};
+      if (sock.nonBlocking) return -{{{ cDefs.EAGAIN }}};
+      await DIRECT_SOCKETS.waitAcceptable(sock);
+      if (sock.acceptQueue.length === 0) return -{{{ cDefs.ECONNABORTED }}};
+    }
+    var accepted = sock.acceptQueue.shift();
+    var openInfo = accepted.openInfo;
+    // Room in the queue again: let the accept loop read the next client
+    DIRECT_SOCKETS.signal(sock.readiness);
+
+    // Create a new socket state for the accepted connection
+    var newSock = DIRECT_SOCKETS.createSocketState(sock.family, sock.type, sock.protocol);
+    newSock.tcpSocket = accepted.tcpSocket;
+    newSock.reader = accepted.reader;
+    newSock.writer = accepted.writer;
+    newSock.remoteAddress = openInfo.remoteAddress || '0.0.0.0';
+    newSock.remotePort = openInfo.remotePort || 0;
+    newSock.localAddress = openInfo.localAddress || sock.localAddress;
+    newSock.localPort = openInfo.localPort || sock.localPort;
+    newSock.nonBlocking = !!(flags & {{{ cDefs.SOCK_NONBLOCK }}});
+    newSock.state = 'connected';
+
+    // Start background reader for poll/non-blocking support
+    DIRECT_SOCKETS.startBackgroundReader(newSock);
+
+    // Write peer address back if requested
+    if (addr) {
+      var errno = writeSockaddr(addr, sock.family, DNS.lookup_name(newSock.remoteAddress), newSock.remotePort, addrlen);
+      if (errno) {
 #if SOCKET_DEBUG
-          dbg(`direct_sockets: accept4 writeSockaddr error: ${errno}`);
+        dbg(`direct_sockets: accept4 writeSockaddr error: ${errno}`);
 #endif
-        }
       }
+    }
 
 #if SOCKET_DEBUG
-      dbg(`direct_sockets: accept4 -> new fd ${newSock.fd}, remote=${newSock.remoteAddress}:${newSock.remotePort}`);
+    dbg(`direct_sockets: accept4 -> new fd ${newSock.fd}, remote=${newSock.remoteAddress}:${newSock.remotePort}`);
 #endif
 
-      return newSock.fd;
-    } catch (e) {
-#if SOCKET_DEBUG
-      dbg(`direct_sockets: accept4 error: ${e}`);
-#endif
-      return -{{{ cDefs.ECONNABORTED }}};
-    }
+    return newSock.fd;
   },
 
+  __syscall_sendto__deps: ['$DIRECT_SOCKETS_PIPES'],
   __syscall_sendto__async: true,
   __syscall_sendto: async (fd, message, length, flags, addr, addr_len) => {
     var sock = DIRECT_SOCKETS.getSocket(fd);
-    if (!sock) return -{{{ cDefs.EBADF }}};
+    if (!sock) {
+      // socketpair: straight from the caller's buffer into the ring
+      return DIRECT_SOCKETS_PIPES.socketSend(fd, [{ buf: null, off: message, len: length }], flags);
+    }
 
     // Copy data from Wasm memory
     var data = new Uint8Array(HEAPU8.buffer, message, length).slice();
 
     if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
       // TCP send - addr is ignored
+      if (sock.state === 'connecting') return -{{{ cDefs.EAGAIN }}};
       if (sock.state !== 'connected') return -{{{ cDefs.ENOTCONN }}};
 
 #if SOCKET_DEBUG
       dbg(`direct_sockets: send(fd=${fd}, length=${length})`);
 #endif
 
-      return DIRECT_SOCKETS.writeToSocket(sock, data);
+      return DIRECT_SOCKETS.writeToSocket(sock, data, flags);
 
     } else {
-      // UDP sendto
-      if (addr && addr_len > 0) {
-        // sendto with explicit destination (requires bound-mode UDP)
-        var dest = DIRECT_SOCKETS.parseSockaddr(addr, addr_len);
-        if (dest.errno) return -dest.errno;
-
-#if SOCKET_DEBUG
-        dbg(`direct_sockets: sendto(fd=${fd}, length=${length}, dest=${dest.addr}:${dest.port})`);
-#endif
-
-        if (sock.state === 'bound' && sock.writer) {
-          // Bound-mode UDP: send with per-message addressing
-          try {
-            await sock.writer.write({
-              data: data,
-              remoteAddress: dest.addr,
-              remotePort: dest.port,
-            });
-            return length;
-          } catch (e) {
-#if SOCKET_DEBUG
-            dbg(`direct_sockets: sendto error: ${e}`);
-#endif
-            return -{{{ cDefs.ENETUNREACH }}};
-          }
-        } else {
-          return -{{{ cDefs.EDESTADDRREQ }}};
-        }
-      } else {
-        // send on connected UDP socket
-        if (sock.state !== 'connected') return -{{{ cDefs.EDESTADDRREQ }}};
-
-#if SOCKET_DEBUG
-        dbg(`direct_sockets: send(fd=${fd}, length=${length}) [connected UDP]`);
-#endif
-
-        try {
-          await sock.writer.write({ data: data });
-          return length;
-        } catch (e) {
-#if SOCKET_DEBUG
-          dbg(`direct_sockets: send error: ${e}`);
-#endif
-          return -{{{ cDefs.ENETUNREACH }}};
-        }
-      }
+      // UDP sendto: bound mode addresses each datagram, connected mode
+      // sends to the peer given to connect()
+      return DIRECT_SOCKETS.sendDatagram(sock, data, addr, addr_len);
     }
   },
 
-  __syscall_recvfrom__deps: ['$writeSockaddr', '$DNS'],
+  __syscall_recvfrom__deps: ['$writeSockaddr', '$DNS', '$DIRECT_SOCKETS_PIPES'],
   __syscall_recvfrom__async: true,
   __syscall_recvfrom: async (fd, buf, len, flags, addr, addrlen) => {
     var sock = DIRECT_SOCKETS.getSocket(fd);
-    if (!sock) return -{{{ cDefs.EBADF }}};
+    if (!sock) {
+      var res = await DIRECT_SOCKETS_PIPES.socketRecv(fd, [{ buf: null, off: buf, len: len }], flags);
+      if (typeof res === 'number') return res;
+      if (addr && addrlen) {{{ makeSetValue('addrlen', 0, 0, 'i32') }}};
+      // MSG_TRUNC: report the real message length even if it did not fit
+      return (flags & 0x20 /*MSG_TRUNC*/) ? res.length : res.copied;
+    }
 
     if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
       // TCP recv
+      if (sock.state === 'connecting') return -{{{ cDefs.EAGAIN }}};
       if (sock.state !== 'connected') return -{{{ cDefs.ENOTCONN }}};
 
 #if SOCKET_DEBUG
       dbg(`direct_sockets: recv(fd=${fd}, len=${len})`);
 #endif
 
-      var data = await DIRECT_SOCKETS.readFromSocket(sock, len);
+      var data = await DIRECT_SOCKETS.readFromSocket(sock, len, flags);
       if (data === 'EAGAIN') return -{{{ cDefs.EAGAIN }}};
       if (typeof data === 'number') return data;  // Error code (negative errno)
       if (!data) return 0;  // Connection closed (EOF)
 
-      HEAPU8.set(data, buf);
+      // MSG_TRUNC on a stream socket discards the data instead of copying it
+      if (!(flags & 0x20 /*MSG_TRUNC*/)) HEAPU8.set(data, buf);
 
       if (addr) {
         var errno = writeSockaddr(addr, sock.family, DNS.lookup_name(sock.remoteAddress), sock.remotePort, addrlen);
@@ -1042,38 +2577,20 @@ var DirectSocketsLibrary = {
       dbg(`direct_sockets: recvfrom(fd=${fd}, len=${len})`);
 #endif
 
-      // Try recvQueue first (filled by background reader)
-      if (sock.recvQueue.length > 0) {
-        var message = sock.recvQueue.shift();
-        var msgData = message.data || message;
-        var copyLen = Math.min(msgData.length, len);
-        HEAPU8.set(msgData.subarray(0, copyLen), buf);
-        if (addr && message.remoteAddress) {
-          var errno = writeSockaddr(addr, sock.family, DNS.lookup_name(message.remoteAddress), message.remotePort, addrlen);
-        }
-        return copyLen;
-      }
-
-      if (sock._bgReaderDone) return 0;
-      if (sock.nonBlocking) return -{{{ cDefs.EAGAIN }}};
-
-      // Wait for background reader to deliver data
-      await new Promise(function(resolve) {
-        DIRECT_SOCKETS._addWaiter(sock, resolve);
-      });
+      var message = await DIRECT_SOCKETS.nextDatagram(sock, flags);
+      if (message === 'EAGAIN') return -{{{ cDefs.EAGAIN }}};
+      if (!message) return 0;
 
-      if (sock.recvQueue.length === 0) return 0;
-
-      var message = sock.recvQueue.shift();
-      var msgData = message.data || message;
+      var msgData = message.data;
       var copyLen = Math.min(msgData.length, len);
       HEAPU8.set(msgData.subarray(0, copyLen), buf);
 
       if (addr && message.remoteAddress) {
-        var errno = writeSockaddr(addr, sock.family, DNS.lookup_name(message.remoteAddress), message.remotePort, addrlen);
+        DIRECT_SOCKETS.writePeer(sock, addr, addrlen, message.remoteAddress, message.remotePort);
       }
 
-      return copyLen;
+      // MSG_TRUNC: report the real datagram length even if it did not fit
+      return (flags & 0x20 /*MSG_TRUNC*/) ? msgData.length : copyLen;
     }
   },
 
@@ -1096,6 +2613,7 @@ var DirectSocketsLibrary = {
       }
       if (how === 1 || how === 2) {
         if (sock.writer) {
+          DIRECT_SOCKETS.flushWrites(sock);
           await sock.writer.close();
           sock.writer = null;
         }
@@ -1149,7 +2667,7 @@ var DirectSocketsLibrary = {
     // musl socket option constants (stable ABI):
     var SO_REUSEADDR = 2, SO_TYPE = 3, SO_SNDBUF = 7, SO_RCVBUF = 8;
     var SO_KEEPALIVE = 9, SO_REUSEPORT = 15;
-    var TCP_NODELAY = 1, TCP_KEEPIDLE = 4, TCP_KEEPINTVL = 5;
+    var TCP_NODELAY = 1, TCP_CORK = 3, TCP_KEEPIDLE = 4, TCP_KEEPINTVL = 5;
     var IP_MULTICAST_TTL = 33, IP_MULTICAST_LOOP = 34;
     var IP_ADD_MEMBERSHIP = 35, IP_DROP_MEMBERSHIP = 36;
     var IPV6_MULTICAST_LOOP = 18, IPV6_MULTICAST_HOPS = 19;
@@ -1184,10 +2702,16 @@ var DirectSocketsLibrary = {
           return 0;
       }
     } else if (level === {{{ cDefs.IPPROTO_TCP }}}) {
+      if (sock.type !== {{{ cDefs.SOCK_STREAM }}}) return -{{{ cDefs.ENOPROTOOPT }}};
       switch (optname) {
         case TCP_NODELAY:
           sock.options.noDelay = !!{{{ makeGetValue('optval', 0, 'i32') }}};
           return 0;
+        case TCP_CORK:
+          // Coalesce writes in the bridge; uncorking flushes what was held
+          sock.cork = !!{{{ makeGetValue('optval', 0, 'i32') }}};
+          if (!sock.cork) DIRECT_SOCKETS.flushWrites(sock);
+          return 0;
         case TCP_KEEPIDLE:
         case TCP_KEEPINTVL:
           // Map to keepAliveDelay (in milliseconds)
@@ -1258,15 +2782,18 @@ var DirectSocketsLibrary = {
   },
 
   // sendmsg/recvmsg: minimal implementations that delegate to sendto/recvfrom
-  __syscall_sendmsg__deps: ['__syscall_sendto'],
+  __syscall_sendmsg__deps: ['__syscall_sendto', '$DIRECT_SOCKETS_PIPES'],
   __syscall_sendmsg__async: true,
   __syscall_sendmsg: async (fd, message, flags) => {
     var sock = DIRECT_SOCKETS.getSocket(fd);
-    if (!sock) return -{{{ cDefs.EBADF }}};
-
     var iov = {{{ makeGetValue('message', C_STRUCTS.msghdr.msg_iov, '*') }}};
     var num = {{{ makeGetValue('message', C_STRUCTS.msghdr.msg_iovlen, 'i32') }}};
 
+    if (!sock) {
+      // socketpair: the iovecs are gathered into one message in the ring
+      return DIRECT_SOCKETS_PIPES.socketSend(fd, DIRECT_SOCKETS_PIPES.iovecs(iov, num), flags);
+    }
+
     var name = {{{ makeGetValue('message', C_STRUCTS.msghdr.msg_name, '*') }}};
     var namelen = {{{ makeGetValue('message', C_STRUCTS.msghdr.msg_namelen, 'i32') }}};
 
@@ -1286,41 +2813,31 @@ var DirectSocketsLibrary = {
 
     // Write through Direct Sockets
     if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
+      if (sock.state === 'connecting') return -{{{ cDefs.EAGAIN }}};
       if (sock.state !== 'connected') return -{{{ cDefs.ENOTCONN }}};
-      return DIRECT_SOCKETS.writeToSocket(sock, view);
+      return DIRECT_SOCKETS.writeToSocket(sock, view, flags);
     } else {
-      if (name && namelen > 0) {
-        var dest = DIRECT_SOCKETS.parseSockaddr(name, namelen);
-        if (dest.errno) return -dest.errno;
-        if (sock.state === 'bound' && sock.writer) {
-          try {
-            await sock.writer.write({ data: view, remoteAddress: dest.addr, remotePort: dest.port });
-            return total;
-          } catch (e) {
-            return -{{{ cDefs.ENETUNREACH }}};
-          }
-        }
-        return -{{{ cDefs.EDESTADDRREQ }}};
-      }
-      if (sock.state !== 'connected') return -{{{ cDefs.EDESTADDRREQ }}};
-      try {
-        await sock.writer.write({ data: view });
-        return total;
-      } catch (e) {
-        return -{{{ cDefs.ENETUNREACH }}};
-      }
+      return DIRECT_SOCKETS.sendDatagram(sock, view, name, namelen);
     }
   },
 
-  __syscall_recvmsg__deps: ['$writeSockaddr', '$DNS'],
+  __syscall_recvmsg__deps: ['$writeSockaddr', '$DNS', '$DIRECT_SOCKETS_PIPES'],
   __syscall_recvmsg__async: true,
   __syscall_recvmsg: async (fd, message, flags) => {
     var sock = DIRECT_SOCKETS.getSocket(fd);
-    if (!sock) return -{{{ cDefs.EBADF }}};
-
     var iov = {{{ makeGetValue('message', C_STRUCTS.msghdr.msg_iov, '*') }}};
     var num = {{{ makeGetValue('message', C_STRUCTS.msghdr.msg_iovlen, 'i32') }}};
 
+    if (!sock) {
+      // socketpair: scatter straight from the ring into the iovecs
+      var res = await DIRECT_SOCKETS_PIPES.socketRecv(fd, DIRECT_SOCKETS_PIPES.iovecs(iov, num), flags);
+      if (typeof res === 'number') return res;
+      var pipeFlags = res.length > res.copied ? 0x20 /*MSG_TRUNC*/ : 0;
+      {{{ makeSetValue('message', C_STRUCTS.msghdr.msg_namelen, 0, 'i32') }}};
+      {{{ makeSetValue('message', C_STRUCTS.msghdr.msg_flags, 'pipeFlags', 'i32') }}};
+      return (pipeFlags && (flags & 0x20 /*MSG_TRUNC*/)) ? res.length : res.copied;
+    }
+
     // Calculate total recv capacity
     var total = 0;
     for (var i = 0; i < num; i++) {
@@ -1328,8 +2845,9 @@ var DirectSocketsLibrary = {
     }
 
     if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
+      if (sock.state === 'connecting') return -{{{ cDefs.EAGAIN }}};
       if (sock.state !== 'connected') return -{{{ cDefs.ENOTCONN }}};
-      var data = await DIRECT_SOCKETS.readFromSocket(sock, total);
+      var data = await DIRECT_SOCKETS.readFromSocket(sock, total, flags);
       if (data === 'EAGAIN') return -{{{ cDefs.EAGAIN }}};
       if (typeof data === 'number') return data;  // Error code (negative errno)
       if (!data) return 0;
@@ -1356,22 +2874,10 @@ var DirectSocketsLibrary = {
       // UDP: consume from recvQueue (populated by background reader)
       if (!sock.reader && sock.recvQueue.length === 0) return -{{{ cDefs.ENOTCONN }}};
 
-      // Check non-blocking mode
-      if (sock.nonBlocking && sock.recvQueue.length === 0) {
-        if (sock._bgReaderDone) return 0;
-        return -{{{ cDefs.EAGAIN }}};
-      }
-
-      // Wait for data if queue is empty
-      if (sock.recvQueue.length === 0) {
-        if (sock._bgReaderDone) return 0;
-        await new Promise(function(resolve) {
-          DIRECT_SOCKETS._addWaiter(sock, resolve);
-        });
-        if (sock.recvQueue.length === 0) return 0;
-      }
+      var msg = await DIRECT_SOCKETS.nextDatagram(sock, flags);
+      if (msg === 'EAGAIN') return -{{{ cDefs.EAGAIN }}};
+      if (!msg) return 0;
 
-      var msg = sock.recvQueue.shift();
       var msgData = msg.data;
       var bytesRead = 0;
       var remaining = msgData.length;
@@ -1386,18 +2892,74 @@ var DirectSocketsLibrary = {
 
       var msgName = {{{ makeGetValue('message', C_STRUCTS.msghdr.msg_name, '*') }}};
       if (msgName && msg.remoteAddress) {
-        writeSockaddr(msgName, sock.family, DNS.lookup_name(msg.remoteAddress), msg.remotePort);
+        DIRECT_SOCKETS.writePeer(sock, msgName, 0, msg.remoteAddress, msg.remotePort);
       }
 
-      return bytesRead;
+      // Datagram did not fit: flag it, and with MSG_TRUNC report its real length
+      var MSG_TRUNC = 0x20;
+      var msgFlags = msgData.length > bytesRead ? MSG_TRUNC : 0;
+      {{{ makeSetValue('message', C_STRUCTS.msghdr.msg_flags, 'msgFlags', 'i32') }}};
+      return (msgFlags && (flags & MSG_TRUNC)) ? msgData.length : bytesRead;
+    }
+  },
+
+  // ---------------------------------------------------------------------------
+  // sendfile() - regular file to socket, pipe or file
+  // ---------------------------------------------------------------------------
+
+  __syscall_sendfile__deps: ['$DIRECT_SOCKETS_PIPES', '$FS', '$readI53FromI64'],
+  __syscall_sendfile__async: true,
+  __syscall_sendfile: async (out_fd, in_fd, offset, count) => {
+    var inStream = FS.getStream(in_fd);
+    if (!inStream) return -{{{ cDefs.EBADF }}};
+    if (!FS.isFile(inStream.node.mode)) return -{{{ cDefs.EINVAL }}};
+    // With an offset pointer the file position is left alone
+    var pos = offset ? readI53FromI64(offset) : inStream.position;
+    if (pos < 0) return -{{{ cDefs.EINVAL }}};
+
+#if SOCKET_DEBUG
+    dbg(`direct_sockets: sendfile(out=${out_fd}, in=${in_fd}, pos=${pos}, count=${count})`);
+#endif
+
+    var sent;
+    var sock = DIRECT_SOCKETS.getSocket(out_fd);
+    if (sock) {
+      sent = await DIRECT_SOCKETS.spliceToSocket(sock, inStream, pos, count);
+    } else if (DIRECT_SOCKETS_PIPES.getPipe(out_fd)) {
+      // One chunk per call: pipes take at most their capacity anyway
+      var chunk = DIRECT_SOCKETS.readFileChunk(inStream, pos, Math.min(count, DIRECT_SOCKETS.SPLICE_CHUNK));
+      sent = chunk.length ? await DIRECT_SOCKETS_PIPES.send(out_fd, [{ buf: chunk, off: 0, len: chunk.length }], 0) : 0;
+    } else {
+      var outStream = FS.getStream(out_fd);
+      if (!outStream) return -{{{ cDefs.EBADF }}};
+      sent = 0;
+      try {
+        while (sent < count) {
+          var chunk = DIRECT_SOCKETS.readFileChunk(inStream, pos + sent, Math.min(count - sent, DIRECT_SOCKETS.SPLICE_CHUNK));
+          if (chunk.length === 0) break;
+          sent += FS.write(outStream, chunk, 0, chunk.length);
+        }
+      } catch (e) {
+        if (!(e instanceof FS.ErrnoError)) throw e;
+        if (sent === 0) return -e.errno;
+      }
+    }
+
+    if (sent > 0) {
+      if (offset) {
+        {{{ makeSetValue('offset', 0, 'pos + sent', 'i64') }}};
+      } else {
+        inStream.position = pos + sent;
+      }
     }
+    return sent;
   },
 
   // ---------------------------------------------------------------------------
   // poll() implementation
   // ---------------------------------------------------------------------------
 
-  __syscall_poll__deps: ['$DIRECT_SOCKETS_PIPES'],
+  __syscall_poll__deps: ['$DIRECT_SOCKETS_PIPES', '$DIRECT_SOCKETS_TIMERS'],
   __syscall_poll__async: true,
   __syscall_poll: async (fds, nfds, timeout) => {
     // struct pollfd { int fd; short events; short revents; }
@@ -1433,35 +2995,46 @@ var DirectSocketsLibrary = {
     // If any events detected or timeout is 0, return immediately
     if (count > 0 || timeout === 0) return count;
 
-    // Phase 2: async wait (timeout > 0 or timeout === -1 for infinite)
+    // Phase 2: async wait (timeout > 0 or timeout === -1 for infinite).
+    // One notifier is subscribed to every watched fd's readiness object; a
+    // signal only re-checks the pollfd entries for the fd that changed.
+    var watched = new Map();  // readiness object -> pollfd indices
+    for (var i = 0; i < nfds; i++) {
+      var ptr = fds + i * POLLFD_SIZE;
+      var fd = {{{ makeGetValue('ptr', 0, 'i32') }}};
+      var events = {{{ makeGetValue('ptr', 4, 'i16') }}};
+      var rd = null;
+
+      var sock = DIRECT_SOCKETS.getSocket(fd);
+      if (sock) {
+        rd = sock.readiness;
+        // Ensure background reader is running for connected sockets
+        if ((events & 1 /*POLLIN*/) && sock.state === 'connected' && sock.reader && !sock._bgReaderRunning) {
+          DIRECT_SOCKETS.startBackgroundReader(sock);
+        }
+      } else {
+        var pipeEntry = DIRECT_SOCKETS_PIPES.getPipe(fd);
+        if (pipeEntry) rd = pipeEntry.readiness;
+      }
+      if (!rd) continue;
+      if (!watched.has(rd)) watched.set(rd, []);
+      watched.get(rd).push(i);
+    }
+
     return new Promise(function(resolve) {
       var timer = null;
-      var resolved = false;
-
-      var cleanup = function() {
-        if (resolved) return;
-        resolved = true;
-        if (timer) clearTimeout(timer);
-        // Remove our waiter from all watched fds
-        for (var i = 0; i < nfds; i++) {
-          var ptr = fds + i * POLLFD_SIZE;
-          var fd = {{{ makeGetValue('ptr', 0, 'i32') }}};
-          var sock = DIRECT_SOCKETS.getSocket(fd);
-          if (sock) DIRECT_SOCKETS._removeWaiter(sock, onNotify);
-          var pipeEntry = DIRECT_SOCKETS_PIPES.getPipe(fd);
-          if (pipeEntry) {
-            if (pipeEntry.pipe.pollNotify === onNotify) pipeEntry.pipe.pollNotify = null;
-            if (pipeEntry.writePipe && pipeEntry.writePipe.pollNotify === onNotify) pipeEntry.writePipe.pollNotify = null;
-          }
-        }
+
+      var finish = function(result) {
+        if (timer) DIRECT_SOCKETS_TIMERS.cancel(timer);
+        watched.forEach((indices, rd) => DIRECT_SOCKETS.unsubscribe(rd, onNotify));
+        resolve(result);
       };
 
-      var onNotify = function() {
-        if (resolved) return;
-        // Re-scan all fds
+      var onNotify = function(rd) {
+        var indices = watched.get(rd);
         var newCount = 0;
-        for (var i = 0; i < nfds; i++) {
-          var ptr = fds + i * POLLFD_SIZE;
+        for (var j = 0; j < indices.length; j++) {
+          var ptr = fds + indices[j] * POLLFD_SIZE;
           var fd = {{{ makeGetValue('ptr', 0, 'i32') }}};
           var events = {{{ makeGetValue('ptr', 4, 'i16') }}};
           var revents = 0;
@@ -1473,59 +3046,181 @@ var DirectSocketsLibrary = {
             var sock = DIRECT_SOCKETS.getSocket(fd);
             if (sock) {
               revents = DIRECT_SOCKETS.computeRevents(sock, events);
+              if (revents) DIRECT_SOCKETS_STATS.wakeup(sock);
             }
           }
 
           {{{ makeSetValue('ptr', 6, 'revents', 'i16') }}};
           if (revents) newCount++;
         }
-        if (newCount > 0) {
-          cleanup();
-          resolve(newCount);
-        }
-        // If no events yet, notifiers are still registered - keep waiting
+        // Other fds were not signalled, so their revents are still 0
+        if (newCount > 0) finish(newCount);
       };
 
       // Set timeout
       if (timeout > 0) {
-        timer = setTimeout(function() {
-          cleanup();
-          resolve(0);
-        }, timeout);
+        timer = DIRECT_SOCKETS_TIMERS.add(timeout, function() { finish(0); });
       }
 
-      // Register poll notifiers on each watched fd (for both POLLIN and POLLOUT)
-      for (var i = 0; i < nfds; i++) {
-        var ptr = fds + i * POLLFD_SIZE;
-        var fd = {{{ makeGetValue('ptr', 0, 'i32') }}};
-        var events = {{{ makeGetValue('ptr', 4, 'i16') }}};
+      watched.forEach((indices, rd) => DIRECT_SOCKETS.subscribe(rd, onNotify));
+    });
+  },
 
-        var sock = DIRECT_SOCKETS.getSocket(fd);
-        if (sock) {
-          DIRECT_SOCKETS._addWaiter(sock, onNotify);
-          // Ensure background reader is running for connected sockets
-          if ((events & 1 /*POLLIN*/) && sock.state === 'connected' && sock.reader && !sock._bgReaderRunning) {
-            DIRECT_SOCKETS.startBackgroundReader(sock);
-          }
-        }
-        var pipeEntry = DIRECT_SOCKETS_PIPES.getPipe(fd);
-        if (pipeEntry) {
-          pipeEntry.pipe.pollNotify = onNotify;
-          if (pipeEntry.writePipe) {
-            pipeEntry.writePipe.pollNotify = onNotify;
-          }
-        }
+  // ---------------------------------------------------------------------------
+  // epoll_create1() / epoll_ctl() / epoll_pwait() implementation
+  // ---------------------------------------------------------------------------
+
+  __syscall_epoll_create1__deps: ['$DIRECT_SOCKETS_EPOLL'],
+  __syscall_epoll_create1: (flags) => {
+    var EPOLL_CLOEXEC = {{{ cDefs.O_CLOEXEC }}};
+    if (flags & ~EPOLL_CLOEXEC) return -{{{ cDefs.EINVAL }}};
+    var ep = DIRECT_SOCKETS_EPOLL.create();
+
+#if SOCKET_DEBUG
+    dbg('direct_sockets: epoll_create1() -> ' + ep.fd);
+#endif
+
+    return ep.fd;
+  },
+
+  __syscall_epoll_ctl__deps: ['$DIRECT_SOCKETS_EPOLL', '$DIRECT_SOCKETS_PIPES'],
+  __syscall_epoll_ctl: (epfd, op, fd, event) => {
+    var EPOLL_CTL_ADD = 1, EPOLL_CTL_DEL = 2, EPOLL_CTL_MOD = 3;
+    var ep = DIRECT_SOCKETS_EPOLL.getInstance(epfd);
+    if (!ep) return -{{{ cDefs.EBADF }}};
+    if (fd === epfd) return -{{{ cDefs.EINVAL }}};
+
+    var sock = DIRECT_SOCKETS.getSocket(fd);
+    var pipeEntry = sock ? null : DIRECT_SOCKETS_PIPES.getPipe(fd);
+    if (!sock && !pipeEntry) {
+      // Regular files are always ready and not pollable, same as Linux
+      return FS.getStream(fd) ? -{{{ cDefs.EPERM }}} : -{{{ cDefs.EBADF }}};
+    }
+
+    var item = ep.interest.get(fd);
+    if (item && item.rd.closed) {
+      // Stale entry for a closed fd whose number has been reused
+      DIRECT_SOCKETS_EPOLL.unlink(item);
+      ep.interest.delete(fd);
+      item = null;
+    }
+
+#if SOCKET_DEBUG
+    dbg(`direct_sockets: epoll_ctl(epfd=${epfd}, op=${op}, fd=${fd})`);
+#endif
+
+    if (op === EPOLL_CTL_DEL) {
+      if (!item) return -{{{ cDefs.ENOENT }}};
+      DIRECT_SOCKETS_EPOLL.unlink(item);
+      ep.interest.delete(fd);
+      return 0;
+    }
+
+    if (op !== EPOLL_CTL_ADD && op !== EPOLL_CTL_MOD) return -{{{ cDefs.EINVAL }}};
+    if (op === EPOLL_CTL_ADD && item) return -{{{ cDefs.EEXIST }}};
+    if (op === EPOLL_CTL_MOD && !item) return -{{{ cDefs.ENOENT }}};
+
+    var events = {{{ makeGetValue('event', 0, 'i32') }}};
+    var dataLo = {{{ makeGetValue('event', 8, 'i32') }}};
+    var dataHi = {{{ makeGetValue('event', 12, 'i32') }}};
+
+    if (op === EPOLL_CTL_ADD) {
+      item = {
+        ep: ep,
+        fd: fd,
+        sock: sock,
+        rd: sock ? sock.readiness : pipeEntry.readiness,
+        notify: null,
+        events: events,
+        dataLo: dataLo,
+        dataHi: dataHi,
+        seenGen: -1,
+        queued: false,
+        removed: false,
+      };
+      ep.interest.set(fd, item);
+      DIRECT_SOCKETS_EPOLL.link(item);
+      // Ensure background reader is running so data arrival can push the item
+      if (sock && (events & {{{ cDefs.POLLIN }}}) && sock.reader && !sock._bgReaderRunning) {
+        DIRECT_SOCKETS.startBackgroundReader(sock);
+      }
+    } else {
+      item.events = events;
+      item.dataLo = dataLo;
+      item.dataHi = dataHi;
+      item.seenGen = -1;
+    }
+
+    // The fd may already be ready; queue it so the next epoll_wait checks it
+    item.notify();
+    return 0;
+  },
+
+  __syscall_epoll_pwait__deps: ['$DIRECT_SOCKETS_EPOLL', '$DIRECT_SOCKETS_TIMERS'],
+  __syscall_epoll_pwait__async: true,
+  __syscall_epoll_pwait: async (epfd, events, maxevents, timeout, sigmask, sigsetsize) => {
+    var ep = DIRECT_SOCKETS_EPOLL.getInstance(epfd);
+    if (!ep) return -{{{ cDefs.EBADF }}};
+    if (maxevents <= 0) return -{{{ cDefs.EINVAL }}};
+
+    var count = DIRECT_SOCKETS_EPOLL.harvest(ep, events, maxevents);
+    if (count > 0 || timeout === 0) return count;
+
+    return new Promise(function(resolve) {
+      var timer = null;
+
+      var finish = function(result) {
+        if (timer) DIRECT_SOCKETS_TIMERS.cancel(timer);
+        DIRECT_SOCKETS.unsubscribe(ep.readiness, onReady);
+        resolve(result);
+      };
+
+      var onReady = function() {
+        // epoll fd was closed while we were waiting
+        if (ep.readiness.closed) return finish(-{{{ cDefs.EBADF }}});
+        var n = DIRECT_SOCKETS_EPOLL.harvest(ep, events, maxevents, true);
+        // n === 0 is a spurious wakeup (readiness already consumed) - keep waiting
+        if (n > 0) finish(n);
+      };
+
+      if (timeout > 0) {
+        timer = DIRECT_SOCKETS_TIMERS.add(timeout, function() { finish(0); });
       }
+
+      DIRECT_SOCKETS.subscribe(ep.readiness, onReady);
     });
   },
 
+  // libc entry points (musl's epoll.c is not part of Emscripten's libc)
+  epoll_create__deps: ['__syscall_epoll_create1', '$DIRECT_SOCKETS_EPOLL'],
+  epoll_create: (size) => {
+    if (size <= 0) return DIRECT_SOCKETS_EPOLL.ret(-{{{ cDefs.EINVAL }}});
+    return DIRECT_SOCKETS_EPOLL.ret(___syscall_epoll_create1(0));
+  },
+
+  epoll_create1__deps: ['__syscall_epoll_create1', '$DIRECT_SOCKETS_EPOLL'],
+  epoll_create1: (flags) => DIRECT_SOCKETS_EPOLL.ret(___syscall_epoll_create1(flags)),
+
+  epoll_ctl__deps: ['__syscall_epoll_ctl', '$DIRECT_SOCKETS_EPOLL'],
+  epoll_ctl: (epfd, op, fd, event) => DIRECT_SOCKETS_EPOLL.ret(___syscall_epoll_ctl(epfd, op, fd, event)),
+
+  epoll_pwait__deps: ['__syscall_epoll_pwait', '$DIRECT_SOCKETS_EPOLL'],
+  epoll_pwait__async: true,
+  epoll_pwait: async (epfd, events, maxevents, timeout, sigmask) =>
+    DIRECT_SOCKETS_EPOLL.ret(await ___syscall_epoll_pwait(epfd, events, maxevents, timeout, sigmask, 8)),
+
+  epoll_wait__deps: ['__syscall_epoll_pwait', '$DIRECT_SOCKETS_EPOLL'],
+  epoll_wait__async: true,
+  epoll_wait: async (epfd, events, maxevents, timeout) =>
+    DIRECT_SOCKETS_EPOLL.ret(await ___syscall_epoll_pwait(epfd, events, maxevents, timeout, 0, 8)),
+
   // ---------------------------------------------------------------------------
   // pipe2() implementation
   // ---------------------------------------------------------------------------
 
   __syscall_pipe2__deps: ['$DIRECT_SOCKETS_PIPES'],
   __syscall_pipe2: (fdsPtr, flags) => {
-    var result = DIRECT_SOCKETS_PIPES.createPipe();
+    var result = DIRECT_SOCKETS_PIPES.createPipe(!!(flags & {{{ cDefs.O_NONBLOCK }}}));
 
 #if SOCKET_DEBUG
     dbg('direct_sockets: pipe2() -> read=' + result.readFd + ', write=' + result.writeFd);
@@ -1542,29 +3237,30 @@ var DirectSocketsLibrary = {
 
   __syscall_socketpair__deps: ['$DIRECT_SOCKETS_PIPES'],
   __syscall_socketpair: (domain, type, protocol, sv) => {
+    // SOCK_DGRAM and SOCK_SEQPACKET keep message boundaries
+    var baseType = type & ~({{{ cDefs.SOCK_CLOEXEC | cDefs.SOCK_NONBLOCK }}});
+    if (baseType !== {{{ cDefs.SOCK_STREAM }}} && baseType !== {{{ cDefs.SOCK_DGRAM }}} &&
+        baseType !== {{{ cDefs.SOCK_SEQPACKET }}}) {
+      return -{{{ cDefs.EINVAL }}};
+    }
+    var messages = baseType !== {{{ cDefs.SOCK_STREAM }}};
+
     // Two cross-connected pipes: fd0's write goes to fd1's read and vice versa
     var fd0 = DIRECT_SOCKETS_PIPES.allocatePipeFd('sockpair[0.' + Object.keys(DIRECT_SOCKETS_PIPES.pipes).length + ']');
     var fd1 = DIRECT_SOCKETS_PIPES.allocatePipeFd('sockpair[1.' + Object.keys(DIRECT_SOCKETS_PIPES.pipes).length + ']');
 
     // Create pipe objects directly (no intermediate fds needed)
-    var spPipe0to1 = {
-      buffer: [],
-      closed: { read: false, write: false },
-      pollNotify: null,
-    };
-    var spPipe1to0 = {
-      buffer: [],
-      closed: { read: false, write: false },
-      pollNotify: null,
-    };
+    var spPipe0to1 = DIRECT_SOCKETS_PIPES.createBuffer(messages);
+    var spPipe1to0 = DIRECT_SOCKETS_PIPES.createBuffer(messages);
 
     // fd0 reads from spPipe1to0, writes to spPipe0to1
     // fd1 reads from spPipe0to1, writes to spPipe1to0
-    DIRECT_SOCKETS_PIPES.pipes[fd0] = { pipe: spPipe1to0, end: 'read', otherFd: fd1, writePipe: spPipe0to1 };
-    DIRECT_SOCKETS_PIPES.pipes[fd1] = { pipe: spPipe0to1, end: 'read', otherFd: fd0, writePipe: spPipe1to0 };
+    var nonBlocking = !!(type & {{{ cDefs.SOCK_NONBLOCK }}});
+    DIRECT_SOCKETS_PIPES.register(fd0, { pipe: spPipe1to0, end: 'read', otherFd: fd1, writePipe: spPipe0to1, nonBlocking: nonBlocking });
+    DIRECT_SOCKETS_PIPES.register(fd1, { pipe: spPipe0to1, end: 'read', otherFd: fd0, writePipe: spPipe1to0, nonBlocking: nonBlocking });
 
 #if SOCKET_DEBUG
-    dbg('direct_sockets: socketpair() -> fd0=' + fd0 + ', fd1=' + fd1);
+    dbg('direct_sockets: socketpair(type=' + baseType + ') -> fd0=' + fd0 + ', fd1=' + fd1);
 #endif
 
     {{{ makeSetValue('sv', 0, 'fd0', 'i32') }}};
@@ -1584,19 +3280,26 @@ var DirectSocketsLibrary = {
     if (!sock && !pipeEntry) return -{{{ cDefs.EBADF }}};
 
     if (cmd === {{{ cDefs.F_GETFL }}}) {
-      if (sock) {
-        return sock.nonBlocking ? {{{ cDefs.O_NONBLOCK }}} : 0;
-      }
-      return 0;
+      var nonBlocking = sock ? sock.nonBlocking : pipeEntry.nonBlocking;
+      return nonBlocking ? {{{ cDefs.O_NONBLOCK }}} : 0;
     }
     if (cmd === {{{ cDefs.F_SETFL }}}) {
       var flags = {{{ makeGetValue('varargs', 0, 'i32') }}};
       if (sock) {
         sock.nonBlocking = !!(flags & {{{ cDefs.O_NONBLOCK }}});
         sock.flags = flags;
+      } else {
+        pipeEntry.nonBlocking = !!(flags & {{{ cDefs.O_NONBLOCK }}});
       }
       return 0;
     }
+    if (cmd === 1031 /*F_SETPIPE_SZ*/) {
+      return DIRECT_SOCKETS_PIPES.setSize(fd, {{{ makeGetValue('varargs', 0, 'i32') }}});
+    }
+    if (cmd === 1032 /*F_GETPIPE_SZ*/) {
+      if (!pipeEntry || pipeEntry.writePipe) return -{{{ cDefs.EBADF }}};
+      return pipeEntry.pipe.ring.length;
+    }
     if (cmd === {{{ cDefs.F_GETFD }}}) return 0;
     if (cmd === {{{ cDefs.F_SETFD }}}) return 0;
 
@@ -1607,10 +3310,25 @@ var DirectSocketsLibrary = {
   // ioctl - FIONBIO for non-blocking support
   // ---------------------------------------------------------------------------
 
-  // ioctl for FIONBIO / FIONREAD
+  // ioctl for FIONBIO / FIONREAD on sockets and pipes
+  __syscall_ioctl__deps: ['$DIRECT_SOCKETS_PIPES'],
   __syscall_ioctl: (fd, op, varargs) => {
     var sock = DIRECT_SOCKETS.getSocket(fd);
-    if (!sock) return -{{{ cDefs.EBADF }}};
+    if (!sock) {
+      var pipeEntry = DIRECT_SOCKETS_PIPES.getPipe(fd);
+      if (!pipeEntry) return -{{{ cDefs.EBADF }}};
+      var argp = {{{ makeGetValue('varargs', 0, 'i32') }}};
+      if (op === {{{ cDefs.FIONBIO }}}) {
+        pipeEntry.nonBlocking = !!{{{ makeGetValue('argp', 0, 'i32') }}};
+      } else if (op === {{{ cDefs.FIONREAD }}}) {
+        // A message socketpair reports the size of the next message
+        var queued = pipeEntry.pipe.messages
+          ? (pipeEntry.pipe.length ? DIRECT_SOCKETS_PIPES.messageLength(pipeEntry.pipe, pipeEntry.pipe.head) : 0)
+          : pipeEntry.pipe.length;
+        {{{ makeSetValue('argp', 0, 'queued', 'i32') }}};
+      }
+      return 0;
+    }
 
     if (op === {{{ cDefs.FIONBIO }}}) {
       var val = {{{ makeGetValue('varargs', 0, 'i32') }}};
@@ -1625,9 +3343,11 @@ var DirectSocketsLibrary = {
     if (op === {{{ cDefs.FIONREAD }}}) {
       var argp = {{{ makeGetValue('varargs', 0, 'i32') }}};
       var avail = 0;
-      for (var i = 0; i < sock.recvQueue.length; i++) {
-        var entry = sock.recvQueue[i];
-        avail += (entry.data ? entry.data.length : entry.length);
+      if (sock.type === {{{ cDefs.SOCK_STREAM }}}) {
+        for (var i = 0; i < sock.recvQueue.length; i++) avail += sock.recvQueue[i].length;
+      } else if (sock.recvQueue.length > 0) {
+        // UDP: size of the next datagram, as on Linux
+        avail = sock.recvQueue[0].data.length;
       }
       {{{ makeSetValue('argp', 0, 'avail', 'i32') }}};
       return 0;
@@ -1638,10 +3358,502 @@ var DirectSocketsLibrary = {
   },
 
   // ---------------------------------------------------------------------------
-  // DNS resolution - async DoH-based getaddrinfo support
+  // DNS resolution - async getaddrinfo support (UDP/TCP wire format, DoH fallback)
   // ---------------------------------------------------------------------------
 
-  _emscripten_lookup_name__deps: ['$DNS', '$inetPton4', '$UTF8ToString'],
+  // Caching resolver. One entry per (name, record type): positive answers
+  // live for their TTL, NXDOMAIN/NODATA for the SOA-derived negative TTL
+  // (RFC 2308), and expired positive answers are still served for STALE_TTL
+  // while a single background query refreshes them (RFC 8767). Concurrent
+  // lookups of the same (name, type) share one in-flight query.
+  //
+  // Queries go out as RFC 1035 messages over a Direct Sockets UDPSocket to
+  // each configured server in turn, retrying over TCP when the answer is
+  // truncated. Only when no server answers does the query fall back to
+  // RFC 8484 DNS-over-HTTPS.
+  $DIRECT_SOCKETS_DNS__deps: ['$DIRECT_SOCKETS', '$DNS', '$DIRECT_SOCKETS_TRACE'],
+  $DIRECT_SOCKETS_DNS: {
+    // 'ip' or 'ip:port' ('[v6]:port'); Module['directSocketsDNS'] overrides
+    // them, and an empty list goes straight to DoH
+    servers: ['8.8.8.8', '1.1.1.1'],
+    // RFC 8484 endpoint; Module['directSocketsDoH'] overrides it
+    endpoint: 'https://dns.google/dns-query',
+    UDP_TIMEOUT_MS: 1000,
+    TCP_TIMEOUT_MS: 3000,
+    // EDNS(0) UDP payload size (DNS flag day 2020)
+    EDNS_PAYLOAD: 1232,
+    // 'type|name' -> {addresses, negative, expires, staleUntil}
+    cache: {},
+    // 'type|name' -> Promise resolving to a cache entry or null
+    inflight: {},
+    // All TTLs in seconds
+    MIN_TTL: 5,
+    MAX_TTL: 86400,
+    NEG_TTL: 60,        // negative answer without an SOA
+    MAX_NEG_TTL: 10800, // RFC 2308 section 5
+    STALE_TTL: 3600,
+    // Refresh in the background once this fraction of the TTL is left
+    PREFETCH_FRACTION: 0.1,
+
+    // Resolve to [{family, addr}]. AF_UNSPEC queries A and AAAA in parallel
+    // and interleaves the results, IPv6 first (RFC 8305 section 4).
+    async resolve(name, family) {
+      var types = family === {{{ cDefs.AF_INET }}} ? ['A'] :
+                  family === {{{ cDefs.AF_INET6 }}} ? ['AAAA'] : ['AAAA', 'A'];
+      var entries = await Promise.all(types.map((type) => DIRECT_SOCKETS_DNS.query(name, type)));
+      var lists = entries.map((entry, i) => {
+        var fam = types[i] === 'A' ? {{{ cDefs.AF_INET }}} : {{{ cDefs.AF_INET6 }}};
+        return entry && !entry.negative ? entry.addresses.map((addr) => ({ family: fam, addr: addr })) : [];
+      });
+      var longest = Math.max.apply(null, lists.map((l) => l.length));
+      var out = [];
+      for (var i = 0; i < longest; i++) {
+        lists.forEach((l) => { if (i < l.length) out.push(l[i]); });
+      }
+      return out;
+    },
+
+    // Cached entry for (name, type), querying only when there is nothing usable
+    async query(name, type) {
+      var key = type + '|' + name;
+      var entry = DIRECT_SOCKETS_DNS.cache[key];
+      var now = Date.now();
+      if (entry) {
+        if (now < entry.expires) {
+          if (!entry.negative && entry.expires - now < entry.ttl * 1000 * DIRECT_SOCKETS_DNS.PREFETCH_FRACTION) {
+            DIRECT_SOCKETS_DNS.refresh(name, type);
+          }
+          return entry;
+        }
+        if (now < entry.staleUntil) {
+          DIRECT_SOCKETS_DNS.refresh(name, type);
+          return entry;
+        }
+      }
+      return DIRECT_SOCKETS_DNS.refresh(name, type);
+    },
+
+    // Start (or join) the query for (name, type) and update the cache.
+    // A failed query keeps whatever was cached before.
+    refresh(name, type) {
+      var key = type + '|' + name;
+      var pending = DIRECT_SOCKETS_DNS.inflight[key];
+      if (pending) return pending;
+      pending = DIRECT_SOCKETS_DNS.fetchRecords(name, type).then((result) => {
+        delete DIRECT_SOCKETS_DNS.inflight[key];
+        if (!result) return DIRECT_SOCKETS_DNS.cache[key] || null;
+        var now = Date.now();
+        var entry = {
+          addresses: result.addresses,
+          negative: result.addresses.length === 0,
+          ttl: result.ttl,
+          expires: now + result.ttl * 1000,
+          staleUntil: now + (result.ttl + DIRECT_SOCKETS_DNS.STALE_TTL) * 1000,
+        };
+        if (entry.negative) entry.staleUntil = entry.expires;
+        DIRECT_SOCKETS_DNS.cache[key] = entry;
+        return entry;
+      });
+      DIRECT_SOCKETS_DNS.inflight[key] = pending;
+      return pending;
+    },
+
+    // One lookup. Resolves to {addresses, ttl} (empty addresses for
+    // NXDOMAIN/NODATA) or null when no resolver gave a usable answer.
+    async fetchRecords(name, type) {
+      var qtype = type === 'A' ? 1 : 28;
+      var servers = Module['directSocketsDNS'] || DIRECT_SOCKETS_DNS.servers;
+      if (typeof UDPSocket != 'undefined') {
+        for (var i = 0; i < servers.length; i++) {
+          var result = await DIRECT_SOCKETS_DNS.queryServer(servers[i], name, qtype);
+          if (result) return result;
+        }
+      }
+      return DIRECT_SOCKETS_DNS.queryDoH(name, qtype);
+    },
+
+    // Query one server over UDP, then TCP if the answer came back truncated.
+    // A random query ID plus 0x20 case randomization of the name make an
+    // off-path spoofed answer roughly 2^(16 + letters) times harder to land.
+    async queryServer(server, name, qtype) {
+      var dest = DIRECT_SOCKETS_DNS.parseServer(server);
+      var id = DIRECT_SOCKETS_DNS.randomBytes(2);
+      id = (id[0] << 8) | id[1];
+      var qname = DIRECT_SOCKETS_DNS.randomizeCase(name);
+      var query = DIRECT_SOCKETS_DNS.encodeQuery(id, qname, qtype, true);
+      if (!query) return null;
+      var accept = (data) => DIRECT_SOCKETS_DNS.parseMessage(data, id, qname, qtype);
+
+      var start = performance.now();
+      var msg = await DIRECT_SOCKETS_DNS.exchangeUDP(dest, query, accept);
+      if (DIRECT_SOCKETS_TRACE.on) DIRECT_SOCKETS_DNS.trace('dns udp', start, name, qtype, server, msg);
+      if (msg && msg.truncated) {
+        start = performance.now();
+        msg = await DIRECT_SOCKETS_DNS.exchangeTCP(dest, query, accept);
+        if (DIRECT_SOCKETS_TRACE.on) DIRECT_SOCKETS_DNS.trace('dns tcp', start, name, qtype, server, msg);
+      }
+#if SOCKET_DEBUG
+      if (!msg) dbg('direct_sockets: DNS query for ' + name + ' to ' + server + ' failed');
+#endif
+      return msg ? DIRECT_SOCKETS_DNS.toResult(msg) : null;
+    },
+
+    // RFC 8484 GET: ID 0 keeps the request cacheable by HTTP intermediaries
+    async queryDoH(name, qtype) {
+      var query = DIRECT_SOCKETS_DNS.encodeQuery(0, name, qtype, false);
+      if (!query) return null;
+      var endpoint = Module['directSocketsDoH'] || DIRECT_SOCKETS_DNS.endpoint;
+      var b64 = btoa(String.fromCharCode.apply(null, query))
+        .replace(/\+/g, '-').replace(/\//g, '_').replace(/=+$/, '');
+      var start = performance.now();
+      try {
+        var resp = await fetch(endpoint + '?dns=' + b64,
+                               { headers: { 'Accept': 'application/dns-message' } });
+        if (!resp.ok) return null;
+        var data = new Uint8Array(await resp.arrayBuffer());
+      } catch (e) {
+#if SOCKET_DEBUG
+        dbg('direct_sockets: DoH resolution failed for ' + name + ': ' + e);
+#endif
+        return null;
+      } finally {
+        if (DIRECT_SOCKETS_TRACE.on) DIRECT_SOCKETS_DNS.trace('dns doh', start, name, qtype, endpoint, data);
+      }
+      var msg = DIRECT_SOCKETS_DNS.parseMessage(data, 0, name, qtype);
+      return msg ? DIRECT_SOCKETS_DNS.toResult(msg) : null;
+    },
+
+    // Send one datagram and wait for the first reply that matches the query;
+    // anything else (stale or spoofed answers) is dropped
+    async exchangeUDP(dest, query, accept) {
+      var udpSocket = null;
+      var io = { reader: null, writer: null };
+      var timer;
+      var timeout = new Promise((resolve) => {
+        timer = setTimeout(resolve, DIRECT_SOCKETS_DNS.UDP_TIMEOUT_MS, null);
+      });
+      var exchange = (async () => {
+        udpSocket = new UDPSocket({ remoteAddress: dest.addr, remotePort: dest.port });
+        var openInfo = await udpSocket.opened;
+        io.writer = openInfo.writable.getWriter();
+        await io.writer.write({ data: query });
+        io.reader = openInfo.readable.getReader();
+        while (true) {
+          var r = await io.reader.read();
+          if (r.done) return null;
+          var msg = accept(new Uint8Array(r.value.data));
+          if (msg) return msg;
+        }
+      })().catch(() => null);
+      var msg = await Promise.race([exchange, timeout]);
+      clearTimeout(timer);
+      if (udpSocket) DIRECT_SOCKETS_DNS.release(udpSocket, io);
+      return msg;
+    },
+
+    // RFC 1035 section 4.2.2: two-byte length prefix on each message
+    async exchangeTCP(dest, query, accept) {
+      var tcpSocket = null;
+      var io = { reader: null, writer: null };
+      var timer;
+      var timeout = new Promise((resolve) => {
+        timer = setTimeout(resolve, DIRECT_SOCKETS_DNS.TCP_TIMEOUT_MS, null);
+      });
+      var exchange = (async () => {
+        tcpSocket = new TCPSocket(dest.addr, dest.port, { noDelay: true });
+        var openInfo = await tcpSocket.opened;
+        var framed = new Uint8Array(query.length + 2);
+        framed[0] = query.length >> 8;
+        framed[1] = query.length & 0xFF;
+        framed.set(query, 2);
+        io.writer = openInfo.writable.getWriter();
+        await io.writer.write(framed);
+        io.reader = openInfo.readable.getReader();
+        var buf = new Uint8Array(0);
+        while (buf.length < 2 || buf.length < 2 + ((buf[0] << 8) | buf[1])) {
+          var r = await io.reader.read();
+          if (r.done) return null;
+          var grown = new Uint8Array(buf.length + r.value.length);
+          grown.set(buf);
+          grown.set(r.value, buf.length);
+          buf = grown;
+        }
+        return accept(buf.subarray(2, 2 + ((buf[0] << 8) | buf[1])));
+      })().catch(() => null);
+      var msg = await Promise.race([exchange, timeout]);
+      clearTimeout(timer);
+      if (tcpSocket) DIRECT_SOCKETS_DNS.release(tcpSocket, io);
+      return msg;
+    },
+
+    // Close an exchange's socket, answered or not. Direct Sockets rejects
+    // close() while a stream is locked, so the pending read is cancelled and
+    // both locks are dropped first, as in _closeSocket.
+    release(socket, io) {
+      if (io.reader) {
+        io.reader.cancel().catch(() => {});
+        try { io.reader.releaseLock(); } catch (e) {}
+      }
+      if (io.writer) {
+        try { io.writer.releaseLock(); } catch (e) {}
+      }
+      socket.close().catch(() => {});
+    },
+
+    // Span for one DNS exchange; answer is falsy when it failed
+    trace(label, start, name, qtype, server, answer) {
+      DIRECT_SOCKETS_TRACE.span(label, 'direct_sockets.dns', start, performance.now(),
+                                { name: name, type: qtype === 1 ? 'A' : 'AAAA', server: server, ok: !!answer });
+    },
+
+    parseServer(server) {
+      var m = /^\[(.*)\](?::(\d+))?$/.exec(server) || /^([^:]+)(?::(\d+))?$/.exec(server);
+      if (!m) return { addr: server, port: 53 };
+      return { addr: m[1], port: m[2] ? parseInt(m[2], 10) : 53 };
+    },
+
+    randomBytes(n) {
+      var bytes = new Uint8Array(n);
+      if (typeof crypto != 'undefined' && crypto.getRandomValues) {
+        crypto.getRandomValues(bytes);
+      } else {
+        for (var i = 0; i < n; i++) bytes[i] = Math.random() * 256;
+      }
+      return bytes;
+    },
+
+    // DNS 0x20 (draft-vixie-dnsext-dns0x20): flip the case of each letter at
+    // random; the answer must echo the question byte for byte
+    randomizeCase(name) {
+      var bits = DIRECT_SOCKETS_DNS.randomBytes(name.length);
+      var out = '';
+      for (var i = 0; i < name.length; i++) {
+        var c = name[i];
+        out += (bits[i] & 1) ? c.toUpperCase() : c.toLowerCase();
+      }
+      return out;
+    },
+
+    // Header + one question (+ an EDNS(0) OPT record). Null if the name
+    // cannot be encoded.
+    encodeQuery(id, name, qtype, edns) {
+      var labels = name.replace(/\.$/, '').split('.');
+      var bytes = [id >> 8, id & 0xFF, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, edns ? 1 : 0];
+      for (var i = 0; i < labels.length; i++) {
+        var label = labels[i];
+        if (label.length === 0 || label.length > 63) return null;
+        bytes.push(label.length);
+        for (var j = 0; j < label.length; j++) {
+          var c = label.charCodeAt(j);
+          if (c > 0x7F) return null; // IDNs must already be punycode
+          bytes.push(c);
+        }
+      }
+      if (bytes.length - 12 > 254) return null;
+      bytes.push(0, qtype >> 8, qtype & 0xFF, 0, 1);
+      if (edns) {
+        var size = DIRECT_SOCKETS_DNS.EDNS_PAYLOAD;
+        bytes.push(0, 0, 41, size >> 8, size & 0xFF, 0, 0, 0, 0, 0, 0);
+      }
+      return new Uint8Array(bytes);
+    },
+
+    // Read a possibly compressed name at off -> {name, next}, or null
+    readName(data, off) {
+      var labels = [];
+      var next = -1;
+      for (var hops = 0; hops < 128; hops++) {
+        if (off >= data.length) return null;
+        var len = data[off];
+        if (len === 0) {
+          return { name: labels.join('.'), next: next < 0 ? off + 1 : next };
+        }
+        if ((len & 0xC0) === 0xC0) {
+          if (off + 1 >= data.length) return null;
+          if (next < 0) next = off + 2;
+          off = ((len & 0x3F) << 8) | data[off + 1];
+          continue;
+        }
+        if (off + 1 + len > data.length) return null;
+        labels.push(String.fromCharCode.apply(null, data.subarray(off + 1, off + 1 + len)));
+        off += 1 + len;
+      }
+      return null;
+    },
+
+    formatAddress(data, off, len) {
+      if (len === 4) return data.subarray(off, off + 4).join('.');
+      var groups = [];
+      for (var i = 0; i < 16; i += 2) groups.push((data[off + i] << 8) | data[off + i + 1]);
+      // Compress the longest run of two or more zero groups (RFC 5952)
+      var best = -1, bestLen = 1;
+      for (var i = 0; i < 8; i++) {
+        var j = i;
+        while (j < 8 && groups[j] === 0) j++;
+        if (j - i > bestLen) { best = i; bestLen = j - i; }
+      }
+      var hex = groups.map((g) => g.toString(16));
+      if (best < 0) return hex.join(':');
+      return hex.slice(0, best).join(':') + '::' + hex.slice(best + bestLen).join(':');
+    },
+
+    // Parse a response to (id, qname, qtype). Returns null for anything that
+    // is not that response, otherwise {rcode, truncated, addresses, ttl, soa}.
+    parseMessage(data, id, qname, qtype) {
+      if (data.length < 12) return null;
+      var u16 = (o) => (data[o] << 8) | data[o + 1];
+      var u32 = (o) => ((data[o] << 24) | (data[o + 1] << 16) | (data[o + 2] << 8) | data[o + 3]) >>> 0;
+      var flags = u16(2);
+      if (u16(0) !== id || !(flags & 0x8000) || u16(4) !== 1) return null;
+      var q = DIRECT_SOCKETS_DNS.readName(data, 12);
+      if (!q || q.name !== qname.replace(/\.$/, '') || q.next + 4 > data.length) return null;
+      if (u16(q.next) !== qtype) return null;
+
+      var msg = {
+        rcode: flags & 0xF,
+        truncated: !!(flags & 0x0200),
+        addresses: [],
+        ttl: Infinity,
+        soa: null,
+      };
+      var answers = u16(6);
+      var total = answers + u16(8);
+      var off = q.next + 4;
+      for (var i = 0; i < total; i++) {
+        var rr = DIRECT_SOCKETS_DNS.readName(data, off);
+        if (!rr || rr.next + 10 > data.length) break;
+        off = rr.next;
+        var type = u16(off), ttl = u32(off + 4), rdlen = u16(off + 8);
+        var rdata = off + 10;
+        if (rdata + rdlen > data.length) break;
+        if (i < answers && type === qtype && rdlen === (qtype === 1 ? 4 : 16)) {
+          msg.addresses.push(DIRECT_SOCKETS_DNS.formatAddress(data, rdata, rdlen));
+          msg.ttl = Math.min(msg.ttl, ttl);
+        } else if (i >= answers && type === 6) {
+          // SOA RDATA: MNAME, RNAME, then SERIAL REFRESH RETRY EXPIRE MINIMUM
+          var mname = DIRECT_SOCKETS_DNS.readName(data, rdata);
+          var rname = mname && DIRECT_SOCKETS_DNS.readName(data, mname.next);
+          if (rname && rname.next + 20 <= rdata + rdlen) {
+            msg.soa = { ttl: ttl, minimum: u32(rname.next + 16) };
+          }
+        }
+        off = rdata + rdlen;
+      }
+      return msg;
+    },
+
+    // Cacheable result from a parsed response, or null (SERVFAIL, REFUSED...)
+    toResult(msg) {
+      // 0 = NOERROR, 3 = NXDOMAIN
+      if (msg.rcode !== 0 && msg.rcode !== 3) return null;
+      if (msg.rcode === 0 && msg.addresses.length > 0) {
+        var ttl = Math.min(Math.max(msg.ttl, DIRECT_SOCKETS_DNS.MIN_TTL), DIRECT_SOCKETS_DNS.MAX_TTL);
+        return { addresses: msg.addresses, ttl: ttl };
+      }
+      // Negative answer: TTL is min(SOA TTL, SOA MINIMUM) per RFC 2308 section 5
+      var negTtl = msg.soa ? Math.min(msg.soa.ttl, msg.soa.minimum) : DIRECT_SOCKETS_DNS.NEG_TTL;
+      negTtl = Math.min(Math.max(negTtl, DIRECT_SOCKETS_DNS.MIN_TTL), DIRECT_SOCKETS_DNS.MAX_NEG_TTL);
+      return { addresses: [], ttl: negTtl };
+    },
+
+    // Happy Eyeballs v2 (RFC 8305): A and AAAA are looked up in parallel and
+    // TCP attempts start CONNECTION_ATTEMPT_DELAY_MS apart, alternating
+    // families and beginning with IPv6. The first attempt to open wins and
+    // the rest are closed. Resolves to {socket, openInfo, addr, family}, or
+    // {error} once every address has failed.
+    RESOLUTION_DELAY_MS: 50,
+    CONNECTION_ATTEMPT_DELAY_MS: 250,
+
+    happyEyeballs(hostname, port, opts) {
+      var AF_INET = {{{ cDefs.AF_INET }}}, AF_INET6 = {{{ cDefs.AF_INET6 }}};
+      var lists = {};
+      lists[AF_INET] = [];
+      lists[AF_INET6] = [];
+      var lastFamily = AF_INET;
+      var resolving = 2, inFlight = 0;
+      var started = false, done = false, timer = null, lastError = null;
+      var attempts = [];
+
+      return new Promise((resolve) => {
+        var finish = (result) => {
+          done = true;
+          clearTimeout(timer);
+          attempts.forEach((s) => { if (!result || s !== result.socket) s.close().catch(() => {}); });
+          resolve(result || { error: lastError || new Error('no address for ' + hostname) });
+        };
+        var pick = () => {
+          var other = lastFamily === AF_INET ? AF_INET6 : AF_INET;
+          if (lists[other].length) lastFamily = other;
+          var addr = lists[lastFamily].shift();
+          return addr ? { addr: addr, family: lastFamily } : null;
+        };
+        var next = () => {
+          timer = null;
+          if (done) return;
+          var target = pick();
+          if (!target) {
+            if (!inFlight && !resolving) finish(null);
+            return;
+          }
+          started = true;
+          try {
+            var socket = new TCPSocket(target.addr, port, opts);
+          } catch (e) {
+            lastError = e;
+            return next();
+          }
+          inFlight++;
+          attempts.push(socket);
+          socket.opened.then((openInfo) => {
+            if (done) return;
+            finish({ socket: socket, openInfo: openInfo, addr: target.addr, family: target.family });
+          }, (e) => {
+            inFlight--;
+            lastError = e;
+            if (done) return;
+            // A failed attempt starts the next one right away (section 5)
+            clearTimeout(timer);
+            next();
+          });
+          timer = setTimeout(next, DIRECT_SOCKETS_DNS.CONNECTION_ATTEMPT_DELAY_MS);
+        };
+        var arrived = (family, entry) => {
+          resolving--;
+          if (entry && !entry.negative) lists[family].push(...entry.addresses);
+          if (done) return;
+          if (!started && family === AF_INET && resolving) {
+            // Give AAAA a short head start before going with IPv4 (section 3)
+            timer = setTimeout(next, DIRECT_SOCKETS_DNS.RESOLUTION_DELAY_MS);
+            return;
+          }
+          if (!started || !timer) {
+            clearTimeout(timer);
+            next();
+          }
+        };
+        DIRECT_SOCKETS_DNS.query(hostname, 'AAAA').then((e) => arrived(AF_INET6, e));
+        DIRECT_SOCKETS_DNS.query(hostname, 'A').then((e) => arrived(AF_INET, e));
+      });
+    },
+
+    // Map resolved addresses back to the hostname so parseSockaddr can hand
+    // TCPSocket the name (and let the browser do its own resolution)
+    remember(hostname, results) {
+      if (DNS.address_map) {
+        if (!DNS.address_map.addrs) DNS.address_map.addrs = {};
+        if (!DNS.address_map.names) DNS.address_map.names = {};
+        DNS.address_map.addrs[hostname] = results[0].addr;
+      }
+      DIRECT_SOCKETS.dnsCache['_real_' + hostname] = results[0].addr;
+      results.forEach((r) => {
+        if (DNS.address_map) DNS.address_map.names[r.addr] = hostname;
+        DIRECT_SOCKETS.dnsCache['_reverse_' + r.addr] = hostname;
+      });
+      DIRECT_SOCKETS.dnsGeneration++;
+    },
+  },
+
+  _emscripten_lookup_name__deps: ['$DNS', '$inetPton4', '$UTF8ToString', '$DIRECT_SOCKETS_DNS'],
   _emscripten_lookup_name__async: true,
   _emscripten_lookup_name: async (name) => {
     var hostname = UTF8ToString(name);
@@ -1658,54 +3870,88 @@ var DirectSocketsLibrary = {
     }
 
     // Try DoH resolution for real hostnames
-    var realIp = await DIRECT_SOCKETS.resolveDNS(hostname, {{{ cDefs.AF_INET }}});
-    if (realIp) {
+    var results = await DIRECT_SOCKETS_DNS.resolve(hostname, {{{ cDefs.AF_INET }}});
+    if (results.length > 0) {
 #if SOCKET_DEBUG
-      dbg('direct_sockets: DoH resolved ' + hostname + ' -> ' + realIp);
+      dbg('direct_sockets: DoH resolved ' + hostname + ' -> ' + results[0].addr);
 #endif
-      // Convert IP string to packed 32-bit integer (little-endian, same as inetPton4)
-      var parts = realIp.split('.');
-      var packed = ((parseInt(parts[0])) |
-                    (parseInt(parts[1]) << 8) |
-                    (parseInt(parts[2]) << 16) |
-                    (parseInt(parts[3]) << 24)) >>> 0;
-
-      // Register reverse mapping: real IP -> hostname
-      // So parseSockaddr can resolve it back for TCPSocket constructor
-      if (DNS.address_map) {
-        if (!DNS.address_map.addrs) DNS.address_map.addrs = {};
-        if (!DNS.address_map.names) DNS.address_map.names = {};
-        DNS.address_map.addrs[hostname] = realIp;
-        DNS.address_map.names[realIp] = hostname;
-      }
-
-      // Also store in our cache for parseSockaddr
-      DIRECT_SOCKETS.dnsCache['_real_' + hostname] = realIp;
-      DIRECT_SOCKETS.dnsCache['_reverse_' + realIp] = hostname;
-
-      return packed;
+      DIRECT_SOCKETS_DNS.remember(hostname, results);
+      // Packed 32-bit integer (little-endian, same as inetPton4)
+      return inetPton4(results[0].addr);
     }
 
     // Fallback to Emscripten's fake DNS
     return DNS.lookup_name(hostname);
   },
 
-  // Internal helper for closing - not a syscall but used by shutdown and close
+  // Every A/AAAA record for getaddrinfo. Called from musl's __lookup_name
+  // (patched by docker_build.sh) and fills its `struct address` array:
+  // { int family; unsigned scopeid; uint8_t addr[16]; int sortkey; }.
+  // Returns the number of entries, or 0 to fall back to _emscripten_lookup_name.
+  _emscripten_lookup_name_all__deps: ['$inetPton4', '$inetPton6', '$UTF8ToString', '$DIRECT_SOCKETS_DNS'],
+  _emscripten_lookup_name_all__async: true,
+  _emscripten_lookup_name_all: async (name, family, buf, max) => {
+    var hostname = UTF8ToString(name);
+    if (hostname === 'localhost' || /^[\d.]+$/.test(hostname) || hostname.indexOf(':') >= 0) return 0;
+
+    var results = await DIRECT_SOCKETS_DNS.resolve(hostname, family);
+    if (results.length === 0) return 0;
+    DIRECT_SOCKETS_DNS.remember(hostname, results);
+
+    var ADDRESS_SIZE = 28;
+    var count = Math.min(results.length, max);
+    for (var i = 0; i < count; i++) {
+      var ptr = buf + i * ADDRESS_SIZE;
+      HEAPU8.fill(0, ptr, ptr + ADDRESS_SIZE);
+      {{{ makeSetValue('ptr', 0, 'results[i].family', 'i32') }}};
+      if (results[i].family === {{{ cDefs.AF_INET }}}) {
+        {{{ makeSetValue('ptr', 8, 'inetPton4(results[i].addr)', 'i32') }}};
+      } else {
+        var words = inetPton6(results[i].addr);
+        for (var w = 0; w < 4; w++) {
+          {{{ makeSetValue('ptr', '8 + w * 4', 'words[w]', 'i32') }}};
+        }
+      }
+    }
+    return count;
+  },
+
   $DIRECT_SOCKETS__postset: `
+    DIRECT_SOCKETS_TRACE.init(Module['directSocketsTrace']);
+    DIRECT_SOCKETS_STATS.on = !!Module['directSocketsStats'];
+    Module['DirectSockets'] = {
+      stats: DIRECT_SOCKETS_STATS.stats,
+      enableStats: (on = true) => { DIRECT_SOCKETS_STATS.on = !!on; },
+      trace: DIRECT_SOCKETS_TRACE.dump,
+      pool: () => ({ idle: DIRECT_SOCKETS_POOL.idleCount, hits: DIRECT_SOCKETS_POOL.hits, misses: DIRECT_SOCKETS_POOL.misses }),
+    };
     DIRECT_SOCKETS._closeSocket = async function(sock) {
+      var tcp = sock.type === {{{ cDefs.SOCK_STREAM }}};
       try {
+        // Buffered (corked) data is sent before the writer goes away
+        if (tcp) DIRECT_SOCKETS.flushWrites(sock);
+        // A healthy pooled connection is parked rather than closed; this
+        // takes its tcpSocket, reader and writer
+        if (tcp) DIRECT_SOCKETS_POOL.park(sock);
         sock._bgReaderDone = true;
-        DIRECT_SOCKETS._notifyWaiters(sock);
+        DIRECT_SOCKETS.closeReadiness(sock.readiness);
         if (sock.reader) { try { sock.reader.releaseLock(); } catch(e) {} sock.reader = null; }
         if (sock.writer) { try { sock.writer.releaseLock(); } catch(e) {} sock.writer = null; }
-        if (sock.acceptReader) { try { sock.acceptReader.releaseLock(); } catch(e) {} sock.acceptReader = null; }
-        if (sock.tcpSocket) { try { await sock.tcpSocket.close(); } catch(e) {} sock.tcpSocket = null; }
-        if (sock.tcpServer) { try { await sock.tcpServer.close(); } catch(e) {} sock.tcpServer = null; }
-        if (sock.udpSocket) { try { await sock.udpSocket.close(); } catch(e) {} sock.udpSocket = null; }
+        if (tcp) {
+          if (sock.acceptReader) { try { sock.acceptReader.releaseLock(); } catch(e) {} sock.acceptReader = null; }
+          // Connections prefetched but never accepted are reset, as on Linux
+          while (sock.acceptQueue.length) {
+            var pending = sock.acceptQueue.shift();
+            try { pending.reader.releaseLock(); pending.writer.releaseLock(); await pending.tcpSocket.close(); } catch(e) {}
+          }
+          if (sock.tcpSocket) { try { await sock.tcpSocket.close(); } catch(e) {} sock.tcpSocket = null; }
+          if (sock.tcpServer) { try { await sock.tcpServer.close(); } catch(e) {} sock.tcpServer = null; }
+        } else if (sock.udpSocket) {
+          try { await sock.udpSocket.close(); } catch(e) {}
+          sock.udpSocket = null;
+        }
       } catch (e) {}
       sock.state = 'closed';
-      sock.readBuffer = null;
-      sock.readBufferOffset = 0;
       sock.recvQueue = [];
       // Close the FS stream if registered
       if (sock.stream) {
@@ -1718,9 +3964,59 @@ var DirectSocketsLibrary = {
 
 autoAddDeps(DirectSocketsLibrary, '$DIRECT_SOCKETS');
 
+// Syscalls whose first argument is not an fd
+var NOT_FD_SYSCALLS = ['socket', 'socketpair', 'pipe2', 'poll', 'epoll_create1'];
+
+// Count a syscall in DIRECT_SOCKETS_STATS once its (already wrapped) body has
+// returned, attributing it to the socket named by its first argument (by its
+// result for socket()), and record it in DIRECT_SOCKETS_TRACE when tracing.
+// With neither on, the body runs as is. Otherwise the syscall calls itself
+// (by its emitted name, with the leading underscore) with an extra `untimed`
+// argument, which Wasm never passes, to get at its result. Async syscalls are timed; the wall time they spend is what the
+// caller spends suspended under JSPI. Their body runs synchronously up to its
+// first await, so the moment it returns its promise is where the suspension
+// starts.
+function instrumentSyscall(x, library) {
+  if (typeof library[x] != 'function') return;  // __deps, __async, ...
+  var name = x.slice('__syscall_'.length);
+  var t = modifyJSFunction(library[x].toString(), (args, body, async_) => {
+    var fd = name === 'socket' ? 'ret' : NOT_FD_SYSCALLS.includes(name) ? 'undefined' : args.split(',')[0].trim();
+    var sock = fd === 'undefined' ? 'null' : `DIRECT_SOCKETS.sockets[${fd}] || null`;
+    var params = args.trim() ? `${args}, untimed` : 'untimed';
+    var self = args.trim() ? `_${x}(${args}, true)` : `_${x}(true)`;
+    if (async_) {
+      return `async function(${params}) {
+  if (!untimed && (DIRECT_SOCKETS_STATS.on || DIRECT_SOCKETS_TRACE.on)) {
+    let start = performance.now();
+    let pending = ${self};
+    let suspended = DIRECT_SOCKETS_TRACE.on ? performance.now() : 0;
+    let ret = await pending;
+    let end = performance.now();
+    if (DIRECT_SOCKETS_STATS.on) DIRECT_SOCKETS_STATS.syscall('${name}', ${sock}, ret, end - start);
+    if (DIRECT_SOCKETS_TRACE.on) DIRECT_SOCKETS_TRACE.syscall('${name}', ${fd}, ret, start, suspended, end);
+    return ret;
+  }
+${body}
+}`;
+    }
+    return `function(${params}) {
+  if (!untimed && (DIRECT_SOCKETS_STATS.on || DIRECT_SOCKETS_TRACE.on)) {
+    let start = DIRECT_SOCKETS_TRACE.on ? performance.now() : 0;
+    let ret = ${self};
+    if (DIRECT_SOCKETS_STATS.on) DIRECT_SOCKETS_STATS.syscall('${name}', ${sock}, ret, 0);
+    if (DIRECT_SOCKETS_TRACE.on) DIRECT_SOCKETS_TRACE.syscall('${name}', ${fd}, ret, start, 0, performance.now());
+    return ret;
+  }
+${body}
+}`;
+  });
+  library[x] = eval('(' + t + ')');
+}
+
 for (var x in DirectSocketsLibrary) {
   if (x.startsWith('__syscall_')) {
     wrapSyscallFunction(x, DirectSocketsLibrary, false);
+    instrumentSyscall(x, DirectSocketsLibrary);
   }
 }
 
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2026 The Emscripten Authors
+ * SPDX-License-Identifier: MIT
+ *
+ * I/O statistics for -sDIRECT_SOCKETS sockets (libdirectsockets.js).
+ * The same counters are available from JavaScript as
+ * Module.DirectSockets.stats([fd]).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct direct_sockets_stats_t {
+  uint64_t bytes_in;             // bytes received from the network
+  uint64_t bytes_out;            // bytes handed to the socket writer
+  uint64_t datagrams_in;         // UDP datagrams received
+  uint64_t datagrams_out;        // UDP datagrams sent
+  uint64_t syscalls;             // socket syscalls, fd_read/fd_write included
+  uint64_t send_calls;           // sendto, sendmsg, sendfile, write/writev
+  uint64_t recv_calls;           // recvfrom, recvmsg, read/readv
+  uint64_t connect_calls;
+  uint64_t accept_calls;
+  uint64_t poll_calls;           // poll, epoll_wait (global only)
+  uint64_t eagain;               // calls that failed with EAGAIN
+  uint64_t poll_wakeups;         // times a blocked poll/epoll_wait woke for it
+  uint64_t recv_queue_depth;     // received chunks/datagrams not yet read
+  uint64_t max_recv_queue_depth; // high-water mark of recv_queue_depth
+  uint64_t bytes_in_flight;      // written but not yet taken by the network
+  uint64_t open_sockets;         // 1 for a socket, all open sockets for -1
+  double suspended_ms;           // time spent suspended in blocking calls
+} direct_sockets_stats_t;
+
+// Fill *out with the counters of socket fd, or with the totals over every
+// socket (closed ones included) when fd is -1. Returns 0, or -1 if fd is not
+// a socket. Call it from the thread that owns the sockets (with
+// PROXY_TO_PTHREAD, the thread running main()). syscalls, the *_calls
+// fields, eagain and suspended_ms only count calls made while syscall
+// counting is on; see emscripten_direct_sockets_stats_enable().
+int emscripten_direct_sockets_stats(int fd, direct_sockets_stats_t *out);
+
+// Turn syscall counting on (nonzero) or off. It is off unless
+// Module.directSocketsStats is set before startup, because timing every
+// syscall costs about as much as a cheap syscall itself. The byte,
+// datagram, queue and wakeup counters are kept either way.
+void emscripten_direct_sockets_stats_enable(int on);
+
+#ifdef __cplusplus
+}
+#endif
@@ -126,6 +126,36 @@ static ngtcp2_tstamp timestamp_ns(void) {
     return (ngtcp2_tstamp)ts.tv_sec * NGTCP2_SECONDS + (ngtcp2_tstamp)ts.tv_nsec;
 }
 
+/* ============================================================
+ * Timer accuracy
+ *
+ * How late the event loop wakes up relative to ngtcp2's expiry
+ * (ACK delay, pacing, loss detection). Reported every 10s.
+ * ============================================================ */
+
+static struct {
+    uint64_t      count;
+    uint64_t      sum_ns;
+    uint64_t      max_ns;
+    ngtcp2_tstamp last_report;
+} g_timer_stats;
+
+static void record_timer_lateness(ngtcp2_tstamp expiry, ngtcp2_tstamp now) {
+    uint64_t late = now - expiry;
+    g_timer_stats.count++;
+    g_timer_stats.sum_ns += late;
+    if (late > g_timer_stats.max_ns) g_timer_stats.max_ns = late;
+
+    if (now - g_timer_stats.last_report >= 10 * NGTCP2_SECONDS) {
+        fprintf(stderr, "[TIMER] expiry lateness: n=%llu avg=%.1fus max=%.1fus\n",
+                (unsigned long long)g_timer_stats.count,
+                g_timer_stats.sum_ns / 1e3 / g_timer_stats.count,
+                g_timer_stats.max_ns / 1e3);
+        memset(&g_timer_stats, 0, sizeof(g_timer_stats));
+        g_timer_stats.last_report = now;
+    }
+}
+
 /* ============================================================
  * Stream helpers
  * ============================================================ */
@@ -1268,7 +1298,9 @@ int main(void) {
             if (expiry <= now) {
                 timeout_ms = 0;
             } else if (expiry != UINT64_MAX) {
-                uint64_t delta = (expiry - now) / 1000000ULL;
+                /* Round up: truncating a sub-ms remainder to 0 would spin
+                 * on poll() until the timer is due. */
+                uint64_t delta = (expiry - now + 999999ULL) / 1000000ULL;
                 if (delta > 1000) delta = 1000;
                 timeout_ms = (int)delta;
             }
@@ -1285,8 +1317,10 @@ int main(void) {
         /* Handle timer expiry */
         if (g_sconn) {
             ngtcp2_tstamp expiry = ngtcp2_conn_get_expiry(g_sconn->conn);
-            if (expiry <= timestamp_ns()) {
-                int rv = ngtcp2_conn_handle_expiry(g_sconn->conn, timestamp_ns());
+            ngtcp2_tstamp now = timestamp_ns();
+            if (expiry <= now) {
+                if (nready == 0) record_timer_lateness(expiry, now);
+                int rv = ngtcp2_conn_handle_expiry(g_sconn->conn, now);
                 if (rv == NGTCP2_ERR_IDLE_CLOSE) {
                     fprintf(stderr, "[QUIC] Idle timeout — closing connection\n");
                     destroy_server_conn(g_sconn);
@@ -0,0 +1,227 @@
+/**
+ * dns_standin.mjs — Local DNS stand-in for resolver tests and benchmarks
+ *
+ * Usage:
+ *   node dns_standin.mjs [--port 5353] [--http-port 8053] [--delay <ms>]
+ *
+ * Answers RFC 1035 wire-format queries over UDP and TCP on --port, and
+ * RFC 8484 DNS-over-HTTPS (GET ?dns= and POST, over plain HTTP) on
+ * --http-port. Point the WASM module at it before startup:
+ *   Module.directSocketsDNS = ['127.0.0.1:5353'];
+ *   Module.directSocketsDoH = 'http://127.0.0.1:8053/dns-query';
+ * or set Module.directSocketsDNS = [] to exercise the DoH path alone.
+ *
+ * Test zone:
+ *   multi.test    3 A + 2 AAAA records (TTL 30)
+ *   v4only.test   1 A record, NODATA for AAAA (SOA MINIMUM 20)
+ *   big.test      100 A records: truncated over UDP, complete over TCP
+ *   *.bench.test  1 A record (TTL 300), so every name is a cold lookup
+ *   he.test       A 127.0.0.1 + AAAA 100::1 (RFC 6666 discard prefix, so
+ *                 IPv6 connects blackhole) for Happy Eyeballs
+ *   nx.test       NXDOMAIN with an SOA in the authority section (MINIMUM 15)
+ *   anything else: NXDOMAIN without an SOA
+ *
+ * The question is echoed byte for byte, so 0x20 case randomization works.
+ * Every query is logged with its transport, so coalescing (one query per
+ * name/type for N concurrent getaddrinfo calls), negative caching and the
+ * TCP retry after truncation are visible in the output. --delay holds each
+ * answer back to widen the window in which concurrent lookups overlap.
+ */
+
+import { createSocket } from 'dgram';
+import { createServer as createTcpServer } from 'net';
+import { createServer as createHttpServer } from 'http';
+
+const argValue = (name, def) => {
+    const i = process.argv.indexOf(name);
+    return i !== -1 ? Number(process.argv[i + 1]) : def;
+};
+const port = argValue('--port', 5353);
+const httpPort = argValue('--http-port', 8053);
+const delay = argValue('--delay', 0);
+const quiet = process.argv.includes('--quiet');
+
+const TYPE = { A: 1, AAAA: 28, SOA: 6, OPT: 41 };
+const TYPE_NAME = { 1: 'A', 28: 'AAAA' };
+
+const zone = {
+    'multi.test': { A: ['127.0.0.1', '127.0.0.2', '127.0.0.3'], AAAA: ['::1', 'fd00::2'], ttl: 30 },
+    'v4only.test': { A: ['127.0.0.1'], ttl: 30, soaMinimum: 20 },
+    'he.test': { A: ['127.0.0.1'], AAAA: ['100::1'], ttl: 30 },
+    'big.test': { A: Array.from({ length: 100 }, (_, i) => `10.0.${i >> 8}.${i & 255}`), ttl: 30 },
+};
+const nxSoaMinimum = { 'nx.test': 15 };
+
+function lookup(name) {
+    if (zone[name]) return zone[name];
+    if (name.endsWith('.bench.test')) return { A: ['127.0.0.1'], ttl: 300 };
+    return null;
+}
+
+// --- Wire format ----------------------------------------------------------
+
+function encodeName(name) {
+    const parts = name.split('.').filter(Boolean);
+    const out = [];
+    for (const p of parts) out.push(p.length, ...Buffer.from(p, 'latin1'));
+    out.push(0);
+    return Buffer.from(out);
+}
+
+function rr(type, ttl, rdata) {
+    const head = Buffer.alloc(12);
+    head.writeUInt16BE(0xC00C, 0); // pointer to the question name
+    head.writeUInt16BE(type, 2);
+    head.writeUInt16BE(1, 4);
+    head.writeUInt32BE(ttl, 6);
+    head.writeUInt16BE(rdata.length, 10);
+    return Buffer.concat([head, rdata]);
+}
+
+function addressBytes(addr) {
+    if (addr.includes(':')) {
+        const [head, tail] = addr.split('::');
+        const h = head ? head.split(':') : [];
+        const t = tail !== undefined && tail ? tail.split(':') : [];
+        const groups = [...h, ...Array(8 - h.length - t.length).fill('0'), ...t];
+        const b = Buffer.alloc(16);
+        groups.forEach((g, i) => b.writeUInt16BE(parseInt(g, 16), i * 2));
+        return b;
+    }
+    return Buffer.from(addr.split('.').map(Number));
+}
+
+function soaRecord(minimum) {
+    const rdata = Buffer.concat([encodeName('ns.test'), encodeName('hostmaster.test'), Buffer.alloc(20)]);
+    [1, 3600, 600, 86400, minimum].forEach((v, i) => rdata.writeUInt32BE(v, rdata.length - 20 + i * 4));
+    const owner = encodeName('test');
+    const head = Buffer.alloc(10);
+    head.writeUInt16BE(TYPE.SOA, 0);
+    head.writeUInt16BE(1, 2);
+    head.writeUInt32BE(60, 4);
+    head.writeUInt16BE(rdata.length, 8);
+    return Buffer.concat([owner, head, rdata]);
+}
+
+// Parse the question; returns null for anything that is not a plain query
+function parseQuery(msg) {
+    if (msg.length < 12 || msg.readUInt16BE(4) !== 1) return null;
+    let off = 12;
+    const labels = [];
+    while (off < msg.length && msg[off] !== 0) {
+        const len = msg[off];
+        if (len > 63) return null;
+        labels.push(msg.subarray(off + 1, off + 1 + len).toString('latin1'));
+        off += 1 + len;
+    }
+    if (off + 5 > msg.length) return null;
+    const qtype = msg.readUInt16BE(off + 1);
+    const question = msg.subarray(12, off + 5);
+    // EDNS(0) OPT in the additional section advertises the UDP payload size
+    let udpSize = 512;
+    if (msg.readUInt16BE(10) > 0 && off + 5 + 11 <= msg.length && msg.readUInt16BE(off + 6) === TYPE.OPT) {
+        udpSize = Math.max(512, msg.readUInt16BE(off + 8));
+    }
+    return { id: msg.readUInt16BE(0), name: labels.join('.'), qtype, question, udpSize };
+}
+
+function respond(query, maxSize) {
+    const name = query.name.toLowerCase();
+    const entry = lookup(name);
+    let rcode = 0;
+    const answers = [];
+    const authority = [];
+    if (!entry) {
+        rcode = 3;
+        if (nxSoaMinimum[name] !== undefined) authority.push(soaRecord(nxSoaMinimum[name]));
+    } else {
+        for (const addr of entry[TYPE_NAME[query.qtype]] || []) {
+            answers.push(rr(query.qtype, entry.ttl, addressBytes(addr)));
+        }
+        if (answers.length === 0 && entry.soaMinimum !== undefined) authority.push(soaRecord(entry.soaMinimum));
+    }
+
+    const header = Buffer.alloc(12);
+    header.writeUInt16BE(query.id, 0);
+    header.writeUInt16BE(0x8180 | rcode, 2); // QR, RD, RA
+    header.writeUInt16BE(1, 4);
+    header.writeUInt16BE(answers.length, 6);
+    header.writeUInt16BE(authority.length, 8);
+    const full = Buffer.concat([header, query.question, ...answers, ...authority]);
+    if (full.length <= maxSize) return full;
+
+    // Truncated: header + question only, TC set
+    header.writeUInt16BE(0x8380 | rcode, 2);
+    header.writeUInt16BE(0, 6);
+    header.writeUInt16BE(0, 8);
+    return Buffer.concat([header, query.question]);
+}
+
+const counts = {};
+function log(transport, query) {
+    const key = `${TYPE_NAME[query.qtype] || query.qtype} ${query.name.toLowerCase()}`;
+    counts[key] = (counts[key] || 0) + 1;
+    if (!quiet) console.log(`[DNS] ${transport} ${key} (#${counts[key]}) as ${query.name}`);
+}
+
+const later = (fn) => (delay ? setTimeout(fn, delay) : fn());
+
+// --- Transports -----------------------------------------------------------
+
+const udp = createSocket('udp4');
+udp.on('message', (msg, rinfo) => {
+    const query = parseQuery(msg);
+    if (!query) return;
+    log('udp', query);
+    later(() => udp.send(respond(query, query.udpSize), rinfo.port, rinfo.address));
+});
+udp.bind(port, '127.0.0.1');
+
+const tcp = createTcpServer((conn) => {
+    let buf = Buffer.alloc(0);
+    conn.on('data', (chunk) => {
+        buf = Buffer.concat([buf, chunk]);
+        while (buf.length >= 2 && buf.length >= 2 + buf.readUInt16BE(0)) {
+            const msg = buf.subarray(2, 2 + buf.readUInt16BE(0));
+            buf = buf.subarray(2 + msg.length);
+            const query = parseQuery(msg);
+            if (!query) continue;
+            log('tcp', query);
+            later(() => {
+                const reply = respond(query, 65535);
+                const len = Buffer.alloc(2);
+                len.writeUInt16BE(reply.length);
+                conn.write(Buffer.concat([len, reply]));
+            });
+        }
+    });
+    conn.on('error', () => {});
+});
+tcp.listen(port, '127.0.0.1');
+
+const http = createHttpServer(async (req, res) => {
+    const url = new URL(req.url, `http://${req.headers.host}`);
+    let msg;
+    if (req.method === 'POST') {
+        const chunks = [];
+        for await (const c of req) chunks.push(c);
+        msg = Buffer.concat(chunks);
+    } else {
+        msg = Buffer.from(url.searchParams.get('dns') || '', 'base64url');
+    }
+    const query = parseQuery(msg);
+    const headers = { 'Access-Control-Allow-Origin': '*' };
+    if (!query) {
+        res.writeHead(400, headers);
+        res.end();
+        return;
+    }
+    log('doh', query);
+    later(() => {
+        res.writeHead(200, { ...headers, 'Content-Type': 'application/dns-message' });
+        res.end(respond(query, 65535));
+    });
+});
+http.listen(httpPort, '127.0.0.1', () => {
+    console.log(`DNS stand-in: udp+tcp 127.0.0.1:${port}, DoH http://127.0.0.1:${httpPort}/dns-query`);
+});
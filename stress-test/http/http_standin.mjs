@@ -0,0 +1,55 @@
+/**
+ * http_standin.mjs — Local HTTP/1.1 keep-alive server for pool benchmarks
+ *
+ * Usage:
+ *   node http_standin.mjs [--port 8080] [--body <bytes>] [--quiet]
+ *
+ * Answers every GET with a fixed-size body and Content-Length, keeping the
+ * connection open (curl-style clients reuse it until either side closes).
+ * Each new TCP connection is logged with a running count, and the totals
+ * are printed every second while requests arrive, so a repeated-GET loop
+ * shows directly whether connect() reused a pooled connection
+ * (Module.directSocketsPool) or opened a fresh one per request.
+ */
+
+import { createServer } from 'http';
+
+const argValue = (name, def) => {
+    const i = process.argv.indexOf(name);
+    return i !== -1 ? Number(process.argv[i + 1]) : def;
+};
+const port = argValue('--port', 8080);
+const bodySize = argValue('--body', 512);
+const quiet = process.argv.includes('--quiet');
+
+const body = Buffer.alloc(bodySize, 'x');
+let connections = 0;
+let requests = 0;
+let reported = 0;
+
+const server = createServer((req, res) => {
+    requests++;
+    req.resume();
+    res.writeHead(200, {
+        'Content-Type': 'text/plain',
+        'Content-Length': body.length,
+        'Connection': 'keep-alive',
+    });
+    res.end(body);
+});
+server.keepAliveTimeout = 60000;
+
+server.on('connection', (socket) => {
+    connections++;
+    if (!quiet) console.log(`[HTTP] connection #${connections} from ${socket.remoteAddress}:${socket.remotePort}`);
+});
+
+setInterval(() => {
+    if (requests === reported) return;
+    reported = requests;
+    console.log(`[HTTP] ${requests} requests over ${connections} connections`);
+}, 1000).unref();
+
+server.listen(port, '127.0.0.1', () => {
+    console.log(`HTTP stand-in: http://127.0.0.1:${port}/ (${bodySize}-byte body, keep-alive)`);
+});
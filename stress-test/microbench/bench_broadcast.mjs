@@ -0,0 +1,81 @@
+/**
+ * bench_broadcast.mjs — DirectSocketServer room broadcast throughput
+ *
+ * Usage:
+ *   node bench_broadcast.mjs [members] [broadcasts]
+ *
+ * Builds a DirectSocketServer over an in-memory accept stream with `members`
+ * connections in one room, so the numbers are encode and queueing cost, not
+ * network. Reports
+ *   [BENCH] <label>: <broadcasts/s> broadcasts/s, <ns> ns/member
+ * for server.to(room).emit() against the previous per-member emitEvent() loop,
+ * then repeats both with one member whose writes never complete.
+ */
+
+import { DirectSocketServer } from '../../api/direct_sockets_api.js';
+
+const members = Number(process.argv[2]) || 1000;
+const broadcasts = Number(process.argv[3]) || 2000;
+const never = new Promise(() => {});
+
+async function makeRoom(slowMember) {
+    let accept;
+    const server = new DirectSocketServer({
+        socket: { closed: never, close() {} },
+        opened: { readable: new ReadableStream({ start(c) { accept = c; } }) },
+        options: { slowConsumer: 'drop', maxQueuedBytes: 64 * 1024 },
+    });
+    const conns = [];
+    server.on('connection', (c) => { c.join('room'); conns.push(c); });
+    for (let i = 0; i < members; i++) {
+        const stall = slowMember && i === members >> 1;
+        accept.enqueue({
+            closed: never,
+            close() {},
+            opened: Promise.resolve({
+                readable: new ReadableStream(),
+                writable: new WritableStream({ write: () => (stall ? never : undefined) }, { highWaterMark: Infinity }),
+            }),
+        });
+    }
+    while (conns.length < members) await new Promise((r) => setTimeout(r, 1));
+    return { server, conns };
+}
+
+// The previous to(room).emit(): every member encodes its own copy and the
+// broadcast waits for all of them to be written
+const perMember = (conns, event, ...args) => Promise.all(conns.map((c) => c.emitEvent(event, ...args)));
+
+async function run(label, slowMember, broadcast) {
+    const { server, conns } = await makeRoom(slowMember);
+    const payload = { seq: 0, text: 'tick', at: 0 };
+    const deadline = performance.now() + 5000;
+    let sent = 0;
+    const start = performance.now();
+    for (; sent < broadcasts; sent++) {
+        payload.seq = sent;
+        const done = broadcast(server, conns, payload);
+        const timedOut = await Promise.race([done.then(() => false), new Promise((r) => setTimeout(r, Math.max(0, deadline - performance.now()), true))]);
+        if (timedOut) break;
+    }
+    const secs = (performance.now() - start) / 1000;
+    await new Promise((r) => setTimeout(r, 0));
+    if (!label) return;
+    if (sent < broadcasts) {
+        console.log(`[BENCH] ${label}: stalled after ${sent}/${broadcasts} broadcasts (waiting on the slow member)`);
+    } else {
+        console.log(`[BENCH] ${label}: ${(sent / secs).toFixed(0)} broadcasts/s, ${((secs * 1e9) / (sent * members)).toFixed(0)} ns/member`);
+    }
+}
+
+const fanout = (server, conns, payload) => server.to('room').emit('tick', payload);
+const loop = (server, conns, payload) => perMember(conns, 'tick', payload);
+
+console.log(`=== Broadcast benchmark: ${members} members, ${broadcasts} broadcasts ===`);
+await run(null, false, fanout);
+await run(null, false, loop);
+await run('fanout', false, fanout);
+await run('per_member', false, loop);
+await run('fanout_slow_member', true, fanout);
+await run('per_member_slow_member', true, loop);
+process.exit(0);
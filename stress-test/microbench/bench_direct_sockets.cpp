@@ -0,0 +1,1013 @@
+// Microbenchmarks for the Direct Sockets Emscripten backend.
+// Build with: em++ -O2 bench_direct_sockets.cpp -o bench.js -sDIRECT_SOCKETS -sJSPI -sPROXY_TO_PTHREAD -pthread
+//
+// Each benchmark prints one "[BENCH] name: value unit" line so results can be
+// grepped out of the IWA console log and compared between runs.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#include <emscripten/direct_sockets_stats.h>
+#endif
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Wakeup cost with many idle fds and a single active one.
+// poll() rescans every pollfd on each call, epoll_wait() only visits fds
+// that were pushed onto the ready list, so the gap grows with idle fds.
+static void bench_wakeup_idle_fds(int idle, int iterations) {
+  printf("[BENCH] wakeup with %d idle socketpairs + 1 active...\n", idle);
+
+  std::vector<int> readers, writers;
+  for (int i = 0; i < idle + 1; i++) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+      printf("  FAIL: socketpair() errno=%d (%s)\n", errno, strerror(errno));
+      return;
+    }
+    readers.push_back(sv[1]);
+    writers.push_back(sv[0]);
+  }
+  int active_w = writers.back();
+  int active_r = readers.back();
+  char byte = 'x';
+
+  // poll(): all fds in every call
+  std::vector<struct pollfd> pfds(readers.size());
+  for (size_t i = 0; i < readers.size(); i++) {
+    pfds[i].fd = readers[i];
+    pfds[i].events = POLLIN;
+  }
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    write(active_w, &byte, 1);
+    poll(pfds.data(), pfds.size(), -1);
+    read(active_r, &byte, 1);
+  }
+  double poll_ns = (now_ns() - start) / iterations;
+
+  // epoll: interest list registered once
+  int epfd = epoll_create1(0);
+  if (epfd < 0) {
+    printf("  FAIL: epoll_create1() errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  for (size_t i = 0; i < readers.size(); i++) {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = readers[i];
+    epoll_ctl(epfd, EPOLL_CTL_ADD, readers[i], &ev);
+  }
+  struct epoll_event out[16];
+  start = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    write(active_w, &byte, 1);
+    int n = epoll_wait(epfd, out, 16, -1);
+    if (n != 1 || out[0].data.fd != active_r) {
+      printf("  FAIL: epoll_wait returned %d (fd=%d)\n", n, n > 0 ? out[0].data.fd : -1);
+      break;
+    }
+    read(active_r, &byte, 1);
+  }
+  double epoll_ns = (now_ns() - start) / iterations;
+
+  printf("[BENCH] poll_wakeup_%d_idle: %.0f ns/op\n", idle, poll_ns);
+  printf("[BENCH] epoll_wakeup_%d_idle: %.0f ns/op\n", idle, epoll_ns);
+
+  close(epfd);
+  for (size_t i = 0; i < readers.size(); i++) {
+    close(readers[i]);
+    close(writers[i]);
+  }
+}
+
+// Fixed cost of a blocking poll() beyond its timeout: subscribing to each
+// fd's readiness object on entry and unsubscribing on exit.
+static void bench_poll_subscribe_overhead(int nfds, int iterations) {
+  printf("[BENCH] poll() subscribe/unsubscribe on %d idle socketpairs...\n", nfds);
+
+  std::vector<int> fds;
+  std::vector<struct pollfd> pfds(nfds);
+  for (int i = 0; i < nfds; i++) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+      printf("  FAIL: socketpair() errno=%d (%s)\n", errno, strerror(errno));
+      return;
+    }
+    fds.push_back(sv[0]);
+    fds.push_back(sv[1]);
+    pfds[i].fd = sv[1];
+    pfds[i].events = POLLIN;
+  }
+
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    poll(pfds.data(), pfds.size(), 1);
+  }
+  double per_call = (now_ns() - start) / iterations - 1e6;
+
+  printf("[BENCH] poll_subscribe_%d_fds: %.0f ns/op over timeout\n", nfds, per_call);
+
+  for (int fd : fds) close(fd);
+}
+
+// How late poll()/epoll_wait() return after a timeout on idle fds. Back-to-
+// back calls are the case where setTimeout-based timers get clamped to 4ms.
+static void bench_timeout_jitter(int timeout_ms, int iterations) {
+  printf("[BENCH] %dms timeout lateness over %d calls...\n", timeout_ms, iterations);
+
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+    printf("  FAIL: socketpair() errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  struct pollfd pfd = {};
+  pfd.fd = sv[1];
+  pfd.events = POLLIN;
+
+  int epfd = epoll_create1(0);
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, sv[1], &ev);
+
+  for (int which = 0; which < 2; which++) {
+    std::vector<double> late(iterations);
+    for (int i = 0; i < iterations; i++) {
+      double start = now_ns();
+      if (which == 0) {
+        poll(&pfd, 1, timeout_ms);
+      } else {
+        struct epoll_event out;
+        epoll_wait(epfd, &out, 1, timeout_ms);
+      }
+      late[i] = (now_ns() - start) / 1e3 - timeout_ms * 1e3;
+    }
+    std::sort(late.begin(), late.end());
+    double sum = 0;
+    for (double v : late) sum += v;
+    const char* name = which == 0 ? "poll" : "epoll";
+    printf("[BENCH] %s_timeout_%dms_late_avg: %.1f us\n", name, timeout_ms, sum / iterations);
+    printf("[BENCH] %s_timeout_%dms_late_p99: %.1f us\n", name, timeout_ms,
+           late[(size_t)(iterations * 0.99)]);
+    printf("[BENCH] %s_timeout_%dms_late_max: %.1f us\n", name, timeout_ms, late.back());
+  }
+
+  close(epfd);
+  close(sv[0]);
+  close(sv[1]);
+}
+
+// Wall time to open `count` TCP connections to a local stand-in server, one
+// blocking connect() after another vs. all at once with non-blocking
+// connect() + poll() for POLLOUT.
+static void bench_concurrent_connect(const char* host, int port, int count) {
+  printf("[BENCH] %d connects to %s:%d, serialized vs concurrent...\n", count, host, port);
+
+  struct sockaddr_in server = {};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  inet_pton(AF_INET, host, &server.sin_addr);
+
+  std::vector<int> fds;
+  double start = now_ns();
+  for (int i = 0; i < count; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&server, sizeof(server)) < 0) {
+      printf("  FAIL: connect() errno=%d (%s)\n", errno, strerror(errno));
+      close(fd);
+      break;
+    }
+    fds.push_back(fd);
+  }
+  double serial_ms = (now_ns() - start) / 1e6;
+  for (int fd : fds) close(fd);
+  fds.clear();
+
+  start = now_ns();
+  std::vector<struct pollfd> pfds;
+  for (int i = 0; i < count; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    int rc = connect(fd, (struct sockaddr*)&server, sizeof(server));
+    if (rc < 0 && errno != EINPROGRESS) {
+      printf("  FAIL: connect() errno=%d (%s)\n", errno, strerror(errno));
+      close(fd);
+      continue;
+    }
+    struct pollfd pfd = {};
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfds.push_back(pfd);
+    fds.push_back(fd);
+  }
+  int connected = 0, failed = 0;
+  size_t pending = pfds.size();
+  while (pending > 0) {
+    if (poll(pfds.data(), pfds.size(), 10000) <= 0) break;
+    for (auto& pfd : pfds) {
+      if (pfd.fd < 0 || !pfd.revents) continue;
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(pfd.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      if (err == 0 && (pfd.revents & POLLOUT)) connected++; else failed++;
+      pfd.fd = -1;  // poll() ignores negative fds
+      pending--;
+    }
+  }
+  double concurrent_ms = (now_ns() - start) / 1e6;
+  for (int fd : fds) close(fd);
+
+  printf("[BENCH] connect_%d_serialized: %.1f ms\n", count, serial_ms);
+  printf("[BENCH] connect_%d_concurrent: %.1f ms (%d ok, %d failed)\n",
+         count, concurrent_ms, connected, failed);
+}
+
+// Throughput of 100-byte records (TLS-record sized writes) to an echo
+// server: one send() per record, back-to-back write()s, and TCP_CORK.
+// Each mode ends with a plain send(), which only returns once everything
+// queued before it has been handed to the socket.
+static void bench_small_writes(const char* host, int port, int records) {
+  printf("[BENCH] %d x 100-byte records to %s:%d...\n", records, host, port);
+
+  struct sockaddr_in server = {};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  inet_pton(AF_INET, host, &server.sin_addr);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (connect(fd, (struct sockaddr*)&server, sizeof(server)) < 0) {
+    printf("  FAIL: connect() errno=%d (%s)\n", errno, strerror(errno));
+    close(fd);
+    return;
+  }
+
+  char record[100];
+  memset(record, 'r', sizeof(record));
+  const char* modes[] = {"send", "write", "cork"};
+  for (int mode = 0; mode < 3; mode++) {
+    int on = 1, off = 0;
+    if (mode == 2) setsockopt(fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on));
+    double start = now_ns();
+    for (int i = 0; i < records; i++) {
+      if (mode == 1) {
+        write(fd, record, sizeof(record));
+      } else {
+        send(fd, record, sizeof(record), 0);
+      }
+    }
+    if (mode == 2) setsockopt(fd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+    send(fd, record, 1, 0);
+    double secs = (now_ns() - start) / 1e9;
+    printf("[BENCH] small_writes_%s: %.0f writes/s, %.2f MB/s\n", modes[mode],
+           records / secs, records * sizeof(record) / secs / 1e6);
+  }
+
+  close(fd);
+}
+
+// Syscalls per TLS-style record (5-byte header + body) read back from an
+// echo server. "toggle" flips O_NONBLOCK around each read and polls on
+// EAGAIN, the pattern used when recv() flags are unavailable; "flags" uses
+// MSG_WAITALL for the header and the body.
+static int g_syscalls;
+
+static ssize_t read_exact_toggle(int fd, unsigned char* buf, size_t len) {
+  size_t got = 0;
+  int fl = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+  g_syscalls += 2;
+  while (got < len) {
+    ssize_t n = recv(fd, buf + got, len - got, 0);
+    g_syscalls++;
+    if (n > 0) {
+      got += n;
+    } else if (n < 0 && errno == EAGAIN) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      poll(&pfd, 1, 5000);
+      g_syscalls++;
+    } else {
+      break;
+    }
+  }
+  fcntl(fd, F_SETFL, fl);
+  g_syscalls++;
+  return got;
+}
+
+static ssize_t read_exact_flags(int fd, unsigned char* buf, size_t len) {
+  g_syscalls++;
+  return recv(fd, buf, len, MSG_WAITALL);
+}
+
+static void bench_record_reads(const char* host, int port, int records) {
+  printf("[BENCH] %d TLS-style records via echo %s:%d...\n", records, host, port);
+
+  struct sockaddr_in server = {};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  inet_pton(AF_INET, host, &server.sin_addr);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (connect(fd, (struct sockaddr*)&server, sizeof(server)) < 0) {
+    printf("  FAIL: connect() errno=%d (%s)\n", errno, strerror(errno));
+    close(fd);
+    return;
+  }
+
+  const size_t body_len = 1000;
+  std::vector<unsigned char> record(5 + body_len, 'b');
+  record[0] = 0x17;  // application_data
+  record[1] = 0x03;
+  record[2] = 0x03;
+  record[3] = body_len >> 8;
+  record[4] = body_len & 0xff;
+  std::vector<unsigned char> in(record.size());
+
+  const char* modes[] = {"toggle", "flags"};
+  for (int mode = 0; mode < 2; mode++) {
+    g_syscalls = 0;
+    double start = now_ns();
+    for (int i = 0; i < records; i++) {
+      send(fd, record.data(), record.size(), 0);
+      ssize_t h = mode == 0 ? read_exact_toggle(fd, in.data(), 5) : read_exact_flags(fd, in.data(), 5);
+      size_t len = (in[3] << 8) | in[4];
+      ssize_t b = mode == 0 ? read_exact_toggle(fd, in.data() + 5, len) : read_exact_flags(fd, in.data() + 5, len);
+      if (h != 5 || b != (ssize_t)body_len) {
+        printf("  FAIL: short record (%zd + %zd)\n", h, b);
+        break;
+      }
+    }
+    double us = (now_ns() - start) / 1e3 / records;
+    printf("[BENCH] record_read_%s: %.1f syscalls/record, %.1f us/record\n",
+           modes[mode], (double)g_syscalls / records, us);
+  }
+
+  close(fd);
+}
+
+// Pipe ping-pong latency (one byte there and back over two pipes) and
+// bulk throughput through the ring, with the default 64 KiB capacity and
+// after F_SETPIPE_SZ grows it to 1 MiB.
+static void bench_pipe(int iterations) {
+  printf("[BENCH] pipe ping-pong and throughput...\n");
+
+  int a[2], b[2];
+  if (pipe(a) < 0 || pipe(b) < 0) {
+    printf("  FAIL: pipe() errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  char byte = 'x';
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    write(a[1], &byte, 1);
+    read(a[0], &byte, 1);
+    write(b[1], &byte, 1);
+    read(b[0], &byte, 1);
+  }
+  printf("[BENCH] pipe_pingpong: %.0f ns/round-trip\n", (now_ns() - start) / iterations);
+
+  static const size_t sizes[] = {65536, 1048576};
+  std::vector<char> buf(1048576);
+  for (size_t capacity : sizes) {
+    if (fcntl(a[1], F_SETPIPE_SZ, (int)capacity) < 0) {
+      printf("  FAIL: F_SETPIPE_SZ errno=%d (%s)\n", errno, strerror(errno));
+      break;
+    }
+    // Half-capacity chunks: the single thread fills then drains, so a
+    // chunk must never have to wait for room
+    size_t chunk = capacity / 2;
+    size_t total = 0, target = (size_t)iterations * 4096;
+    start = now_ns();
+    while (total < target) {
+      ssize_t n = write(a[1], buf.data(), chunk);
+      if (n <= 0) break;
+      for (ssize_t got = 0; got < n;) {
+        ssize_t r = read(a[0], buf.data(), buf.size());
+        if (r <= 0) break;
+        got += r;
+      }
+      total += n;
+    }
+    double secs = (now_ns() - start) / 1e9;
+    printf("[BENCH] pipe_throughput_%zuk: %.1f MB/s\n", capacity / 1024, total / secs / 1e6);
+  }
+
+  close(a[0]);
+  close(a[1]);
+  close(b[0]);
+  close(b[1]);
+}
+
+// 1200-byte messages (a typical QUIC datagram) through a SOCK_DGRAM
+// socketpair: sendmsg() copies the iovecs into the ring and recvmsg()
+// scatters each record straight back out, one message per call.
+static void bench_socketpair_dgram(int iterations) {
+  printf("[BENCH] socketpair SOCK_DGRAM 1200-byte messages...\n");
+
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) < 0) {
+    printf("  FAIL: socketpair() errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  static char header[16], payload[1184], in_header[16], in_payload[1184];
+  struct iovec out[2] = {{header, sizeof(header)}, {payload, sizeof(payload)}};
+  struct iovec in[2] = {{in_header, sizeof(in_header)}, {in_payload, sizeof(in_payload)}};
+  struct msghdr smsg = {}, rmsg = {};
+  smsg.msg_iov = out;
+  smsg.msg_iovlen = 2;
+  rmsg.msg_iov = in;
+  rmsg.msg_iovlen = 2;
+
+  // Batches of 32 keep the 64 KiB ring (54 messages) from filling
+  const int batch = 32;
+  long messages = (long)iterations * 10, done = 0, bad = 0;
+  double start = now_ns();
+  while (done < messages) {
+    for (int i = 0; i < batch; i++) sendmsg(sv[0], &smsg, 0);
+    for (int i = 0; i < batch; i++) {
+      if (recvmsg(sv[1], &rmsg, 0) != 1200) bad++;
+    }
+    done += batch;
+  }
+  double secs = (now_ns() - start) / 1e9;
+  printf("[BENCH] socketpair_dgram_1200: %.0f msgs/s, %.1f MB/s (%ld short reads)\n",
+         done / secs, done * 1200.0 / secs / 1e6, bad);
+
+  close(sv[0]);
+  close(sv[1]);
+}
+
+// Per-datagram cost of bound-mode sendto() to one peer, as a QUIC server
+// sends to an established connection, and of recvfrom() reporting that
+// peer's address. Both sides are loopback sockets in this process; the
+// receiver is drained every batch so the socket buffer never fills.
+static void bench_udp_sendto(int iterations) {
+  printf("[BENCH] UDP sendto/recvfrom to a single peer, 1200-byte datagrams...\n");
+
+  int tx = socket(AF_INET, SOCK_DGRAM, 0);
+  int rx = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  if (bind(tx, (struct sockaddr*)&addr, sizeof(addr)) < 0 || bind(rx, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      getsockname(rx, (struct sockaddr*)&addr, &len) < 0) {
+    printf("  FAIL: bind on loopback errno=%d (%s)\n", errno, strerror(errno));
+    close(tx);
+    close(rx);
+    return;
+  }
+
+  static char payload[1200], in[1200];
+  const int batch = 32;
+  long sent = 0, received = 0;
+  double send_ns = 0, recv_ns = 0;
+  while (sent < iterations) {
+    double start = now_ns();
+    for (int i = 0; i < batch; i++) {
+      if (sendto(tx, payload, sizeof(payload), 0, (struct sockaddr*)&addr, sizeof(addr)) == sizeof(payload)) sent++;
+    }
+    send_ns += now_ns() - start;
+    struct pollfd pfd = {rx, POLLIN, 0};
+    poll(&pfd, 1, 100);
+    start = now_ns();
+    struct sockaddr_in from;
+    for (int i = 0; i < batch; i++) {
+      socklen_t flen = sizeof(from);
+      if (recvfrom(rx, in, sizeof(in), 0, (struct sockaddr*)&from, &flen) < 0) break;
+      received++;
+    }
+    recv_ns += now_ns() - start;
+  }
+  printf("[BENCH] udp_sendto_one_peer: %.0f ns/op\n", send_ns / sent);
+  printf("[BENCH] udp_recvfrom_one_peer: %.0f ns/op (%ld of %ld received)\n",
+         received ? recv_ns / received : 0.0, received, sent);
+
+  close(tx);
+  close(rx);
+}
+
+// Accept rate of an event-loop server: a non-blocking listener on loopback
+// is multiplexed with poll(), and each POLLIN wakeup drains every queued
+// connection with accept4(). The client side is this same process opening
+// non-blocking connects in batches, so the loop measures listener readiness
+// plus the accept path rather than a remote peer.
+static void bench_accept_rate(int connections) {
+  printf("[BENCH] accept rate, %d loopback connections via poll()...\n", connections);
+
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  if (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 128) < 0 ||
+      getsockname(lfd, (struct sockaddr*)&addr, &len) < 0) {
+    printf("  FAIL: listen on loopback errno=%d (%s)\n", errno, strerror(errno));
+    close(lfd);
+    return;
+  }
+  fcntl(lfd, F_SETFL, fcntl(lfd, F_GETFL, 0) | O_NONBLOCK);
+
+  const int batch = 64;
+  int accepted = 0, wakeups = 0;
+  std::vector<int> fds;
+  double start = now_ns();
+  while (accepted < connections) {
+    int want = std::min(batch, connections - accepted);
+    for (int i = 0; i < want; i++) {
+      int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+      connect(fd, (struct sockaddr*)&addr, sizeof(addr));
+      fds.push_back(fd);
+    }
+    int got = 0;
+    while (got < want) {
+      struct pollfd pfd = {lfd, POLLIN, 0};
+      if (poll(&pfd, 1, 5000) <= 0) break;
+      wakeups++;
+      int fd;
+      while ((fd = accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+        fds.push_back(fd);
+        got++;
+      }
+    }
+    accepted += got;
+    for (int fd : fds) close(fd);
+    fds.clear();
+    if (got < want) {
+      printf("  FAIL: only %d of %d connections accepted in this batch\n", got, want);
+      break;
+    }
+  }
+  double secs = (now_ns() - start) / 1e9;
+  printf("[BENCH] accept_rate: %.0f conns/s (%d accepted, %.1f accepts per wakeup)\n",
+         accepted / secs, accepted, wakeups ? (double)accepted / wakeups : 0.0);
+  close(lfd);
+}
+
+// Serving a file over a loopback TCP connection: read() into the heap then
+// write() out, versus sendfile(), which splices the file straight into the
+// socket. The sender is non-blocking and the receiving end is drained
+// between sends, so one thread drives both sides.
+static void bench_sendfile(int megabytes) {
+  printf("[BENCH] %d MiB file over loopback, read/write vs sendfile...\n", megabytes);
+
+  const char* path = "/tmp/bench_sendfile.bin";
+  const size_t size = (size_t)megabytes << 20;
+  std::vector<char> block(65536, 's');
+  FILE* f = fopen(path, "wb");
+  if (!f) {
+    printf("  FAIL: fopen(%s) errno=%d (%s)\n", path, errno, strerror(errno));
+    return;
+  }
+  for (size_t i = 0; i < size; i += block.size()) fwrite(block.data(), 1, block.size(), f);
+  fclose(f);
+
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  int tx = socket(AF_INET, SOCK_STREAM, 0);
+  if (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 1) < 0 ||
+      getsockname(lfd, (struct sockaddr*)&addr, &len) < 0 ||
+      connect(tx, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    printf("  FAIL: loopback connection errno=%d (%s)\n", errno, strerror(errno));
+    close(tx);
+    close(lfd);
+    return;
+  }
+  int rx = accept(lfd, nullptr, nullptr);
+  fcntl(tx, F_SETFL, fcntl(tx, F_GETFL, 0) | O_NONBLOCK);
+
+  std::vector<char> sink(262144);
+  const char* modes[] = {"readwrite", "sendfile"};
+  for (int mode = 0; mode < 2; mode++) {
+    int in = open(path, O_RDONLY);
+    size_t sent = 0, got = 0;
+    off_t off = 0;
+    double start = now_ns();
+    while (got < size) {
+      ssize_t n = 0;
+      if (sent < size) {
+        if (mode == 0) {
+          n = pread(in, block.data(), std::min(block.size(), size - sent), sent);
+          if (n > 0) n = write(tx, block.data(), n);
+        } else {
+          n = sendfile(tx, in, &off, size - sent);
+        }
+        if (n > 0) sent += n;
+      }
+      ssize_t r, drained = 0;
+      while ((r = recv(rx, sink.data(), sink.size(), MSG_DONTWAIT)) > 0) drained += r;
+      got += drained;
+      if (n <= 0 && drained == 0) {
+        struct pollfd pfd = {rx, POLLIN, 0};
+        if (poll(&pfd, 1, 1000) <= 0) {
+          printf("  FAIL: %s stalled after %zu of %zu bytes\n", modes[mode], got, size);
+          break;
+        }
+      }
+    }
+    double secs = (now_ns() - start) / 1e9;
+    printf("[BENCH] file_%s: %.1f MB/s\n", modes[mode], got / secs / 1e6);
+    close(in);
+  }
+
+  close(rx);
+  close(tx);
+  close(lfd);
+  unlink(path);
+}
+
+// writev() of 8 iovecs (a TLS-style header/body pattern) versus the same
+// bytes as 8 write() calls, over a loopback connection drained between
+// batches. Under Emscripten it also reports how many writer.write() calls
+// the bridge issued per writev().
+static void bench_writev(int batches) {
+  printf("[BENCH] %d x 8-iovec writev over loopback...\n", batches);
+
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  int tx = socket(AF_INET, SOCK_STREAM, 0);
+  if (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 1) < 0 ||
+      getsockname(lfd, (struct sockaddr*)&addr, &len) < 0 ||
+      connect(tx, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    printf("  FAIL: loopback connection errno=%d (%s)\n", errno, strerror(errno));
+    close(tx);
+    close(lfd);
+    return;
+  }
+  int rx = accept(lfd, nullptr, nullptr);
+
+  static char header[4][5], body[4][1024];
+  struct iovec iov[8];
+  size_t per_call = 0;
+  for (int i = 0; i < 4; i++) {
+    iov[2 * i] = {header[i], sizeof(header[i])};
+    iov[2 * i + 1] = {body[i], sizeof(body[i])};
+    per_call += sizeof(header[i]) + sizeof(body[i]);
+  }
+
+  std::vector<char> sink(65536);
+  const char* modes[] = {"write_x8", "writev"};
+  for (int mode = 0; mode < 2; mode++) {
+#ifdef __EMSCRIPTEN__
+    int writes_before = EM_ASM_INT({ return DIRECT_SOCKETS.getSocket($0).writeCalls; }, tx);
+#endif
+    size_t got = 0, want = per_call * batches;
+    double start = now_ns();
+    for (int b = 0; b < batches; b++) {
+      if (mode == 0) {
+        for (int i = 0; i < 8; i++) write(tx, iov[i].iov_base, iov[i].iov_len);
+      } else {
+        writev(tx, iov, 8);
+      }
+      ssize_t r;
+      while ((r = recv(rx, sink.data(), sink.size(), MSG_DONTWAIT)) > 0) got += r;
+    }
+    while (got < want) {
+      ssize_t r = recv(rx, sink.data(), sink.size(), 0);
+      if (r <= 0) break;
+      got += r;
+    }
+    double secs = (now_ns() - start) / 1e9;
+    printf("[BENCH] %s: %.1f MB/s", modes[mode], got / secs / 1e6);
+#ifdef __EMSCRIPTEN__
+    int writes = EM_ASM_INT({ return DIRECT_SOCKETS.getSocket($0).writeCalls; }, tx) - writes_before;
+    printf(", %.2f writer writes per call", (double)writes / batches);
+#endif
+    printf("\n");
+  }
+
+  close(rx);
+  close(tx);
+  close(lfd);
+}
+
+// Cost of the I/O counters (DIRECT_SOCKETS_STATS): a 64-byte send()/recv()
+// round over loopback with syscall counting off and then on, and the
+// bookkeeping one such round performs (two syscall records with their
+// timestamps, one sent, one received) run on its own. The target is under
+// 1% of the round.
+static void bench_stats_overhead(int rounds) {
+  printf("[BENCH] stats bookkeeping vs a send()/recv() round (%d rounds)...\n", rounds);
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  int tx = socket(AF_INET, SOCK_STREAM, 0);
+  if (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 1) < 0 ||
+      getsockname(lfd, (struct sockaddr*)&addr, &len) < 0 ||
+      connect(tx, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    printf("  FAIL: loopback connection errno=%d (%s)\n", errno, strerror(errno));
+    close(tx);
+    close(lfd);
+    return;
+  }
+  int rx = accept(lfd, nullptr, nullptr);
+  int one = 1;
+  setsockopt(tx, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  auto run = [&]() {
+    char msg[64] = {}, buf[64];
+    double start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+      send(tx, msg, sizeof(msg), 0);
+      for (size_t got = 0; got < sizeof(msg);) {
+        ssize_t r = recv(rx, buf + got, sizeof(buf) - got, 0);
+        if (r <= 0) break;
+        got += r;
+      }
+    }
+    return (now_ns() - start) / rounds;
+  };
+  double round_ns = run();
+  printf("[BENCH] stats_round: %.0f ns\n", round_ns);
+#ifdef __EMSCRIPTEN__
+  emscripten_direct_sockets_stats_enable(1);
+  double counted_ns = run();
+  emscripten_direct_sockets_stats_enable(0);
+  printf("[BENCH] stats_round_counted: %.0f ns (%+.2f%%)\n", counted_ns, 100 * (counted_ns - round_ns) / round_ns);
+  double book_ns = EM_ASM_DOUBLE({
+    var sock = DIRECT_SOCKETS.getSocket($0);
+    var start = performance.now();
+    for (var i = 0; i < $1; i++) {
+      var t = performance.now();
+      DIRECT_SOCKETS_STATS.sent(sock, 64, false);
+      DIRECT_SOCKETS_STATS.syscall('sendto', sock, 64, performance.now() - t);
+      DIRECT_SOCKETS_STATS.received(sock, 64, false);
+      t = performance.now();
+      DIRECT_SOCKETS_STATS.syscall('recvfrom', sock, 64, performance.now() - t);
+    }
+    return (performance.now() - start) * 1e6 / $1;
+  }, tx, rounds);
+  printf("[BENCH] stats_bookkeeping: %.0f ns per round (%.2f%%)\n", book_ns, 100 * book_ns / round_ns);
+#endif
+
+  close(rx);
+  close(tx);
+  close(lfd);
+}
+
+// Bridge overhead without the network: non-blocking recv() that finds the
+// queue empty and getsockname(), round-robin over a mix of open TCP and UDP
+// sockets, so the fd table lookup and the per-kind socket state dominate.
+static void bench_syscall_overhead(int iterations) {
+  const int kSockets = 64;
+  printf("[BENCH] syscall overhead over %d mixed TCP/UDP sockets (%d calls)...\n", kSockets, iterations);
+  std::vector<int> fds;
+  for (int i = 0; i < kSockets; i++) {
+    int fd = socket(AF_INET, (i & 1) ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd >= 0) fds.push_back(fd);
+  }
+  if (fds.empty()) {
+    printf("  FAIL: socket() errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+
+  char buf[64];
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    recv(fds[i % fds.size()], buf, sizeof(buf), MSG_DONTWAIT);
+  }
+  printf("[BENCH] recv_empty: %.0f ns/call\n", (now_ns() - start) / iterations);
+
+  struct sockaddr_in addr;
+  start = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    socklen_t len = sizeof(addr);
+    getsockname(fds[i % fds.size()], (struct sockaddr*)&addr, &len);
+  }
+  printf("[BENCH] getsockname: %.0f ns/call\n", (now_ns() - start) / iterations);
+
+  for (int fd : fds) close(fd);
+}
+
+// Cold-lookup latency (every name is new, so nothing comes from the cache)
+// against stress-test/dns/dns_standin.mjs: wire format over UDP to its DNS
+// port versus RFC 8484 DoH to its HTTP port.
+static void bench_dns_cold_lookup(const char* host, int dns_port, int doh_port, int lookups) {
+  printf("[BENCH] %d cold lookups, UDP wire format vs DoH...\n", lookups);
+#ifdef __EMSCRIPTEN__
+  static const char* modes[] = {"udp", "doh"};
+  for (int m = 0; m < 2; m++) {
+    EM_ASM({
+      var host = UTF8ToString($0);
+      Module['directSocketsDNS'] = $3 ? [] : [host + ':' + $1];
+      Module['directSocketsDoH'] = 'http://' + host + ':' + $2 + '/dns-query';
+    }, host, dns_port, doh_port, m);
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    std::vector<double> samples;
+    int failed = 0;
+    for (int i = 0; i < lookups; i++) {
+      char name[64];
+      snprintf(name, sizeof(name), "%s%d-%d.bench.test", modes[m], i, (int)(now_ns() / 1e6) % 100000);
+      struct addrinfo* res = nullptr;
+      double start = now_ns();
+      int rc = getaddrinfo(name, nullptr, &hints, &res);
+      samples.push_back((now_ns() - start) / 1e3);
+      if (rc != 0) failed++; else freeaddrinfo(res);
+    }
+    std::sort(samples.begin(), samples.end());
+    printf("[BENCH] dns_cold_%s_p50: %.1f us\n", modes[m], samples[samples.size() / 2]);
+    printf("[BENCH] dns_cold_%s_p99: %.1f us (%d failed)\n", modes[m],
+           samples[samples.size() * 99 / 100], failed);
+  }
+#else
+  printf("  SKIP: needs the Emscripten build\n");
+#endif
+}
+
+// Connection setup to he.test on the DNS stand-in, whose AAAA record is
+// blackholed: connecting to the first getaddrinfo result (IPv6) directly
+// versus with Happy Eyeballs racing both families 250 ms apart.
+static void bench_happy_eyeballs(int port, int rounds) {
+  printf("[BENCH] connect to dual-stack he.test:%d with IPv6 blackholed...\n", port);
+#ifdef __EMSCRIPTEN__
+  static const char* modes[] = {"direct", "happy_eyeballs"};
+  for (int m = 0; m < 2; m++) {
+    EM_ASM({ Module['directSocketsHappyEyeballs'] = !!$0; }, m);
+    std::vector<double> samples;
+    int failed = 0;
+    for (int i = 0; i < rounds; i++) {
+      struct addrinfo hints = {};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      struct addrinfo* res = nullptr;
+      char service[16];
+      snprintf(service, sizeof(service), "%d", port);
+      if (getaddrinfo("he.test", service, &hints, &res) != 0) {
+        printf("  FAIL: getaddrinfo(he.test) - is the DNS stand-in configured?\n");
+        return;
+      }
+      int fd = socket(res->ai_family, SOCK_STREAM, 0);
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+      double start = now_ns();
+      int rc = connect(fd, res->ai_addr, res->ai_addrlen);
+      int err = rc == 0 ? 0 : errno;
+      if (rc < 0 && errno == EINPROGRESS) {
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        err = ETIMEDOUT;
+        if (poll(&pfd, 1, 5000) > 0) {
+          socklen_t len = sizeof(err);
+          getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        }
+      }
+      samples.push_back((now_ns() - start) / 1e6);
+      if (err != 0) failed++;
+      close(fd);
+      freeaddrinfo(res);
+    }
+    std::sort(samples.begin(), samples.end());
+    printf("[BENCH] connect_%s_p50: %.1f ms (%d/%d failed)\n", modes[m],
+           samples[samples.size() / 2], failed, rounds);
+  }
+  EM_ASM({ Module['directSocketsHappyEyeballs'] = false; });
+#else
+  printf("  SKIP: needs the Emscripten build\n");
+#endif
+}
+
+// One curl-style GET: connect, send the request, read headers and a
+// Content-Length body, close. Returns false on any failure.
+static bool http_get(const struct sockaddr_in* addr, const char* host, int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  if (connect(fd, (const struct sockaddr*)addr, sizeof(*addr)) < 0) {
+    close(fd);
+    return false;
+  }
+  char req[256];
+  int len = snprintf(req, sizeof(req), "GET / HTTP/1.1\r\nHost: %s:%d\r\nUser-Agent: bench\r\nAccept: */*\r\n\r\n",
+                     host, port);
+  if (send(fd, req, len, 0) != len) {
+    close(fd);
+    return false;
+  }
+  char buf[4096];
+  size_t have = 0;
+  long want = -1;
+  while (want < 0 || (long)have < want) {
+    ssize_t n = recv(fd, buf + have, sizeof(buf) - 1 - have, 0);
+    if (n <= 0) break;
+    have += n;
+    buf[have] = '\0';
+    if (want < 0) {
+      char* end = strstr(buf, "\r\n\r\n");
+      char* cl = strstr(buf, "Content-Length: ");
+      if (end && cl) want = (end + 4 - buf) + atol(cl + 16);
+    }
+  }
+  close(fd);
+  return want >= 0 && (long)have == want;
+}
+
+// Repeated GETs against stress-test/http/http_standin.mjs, each on its own
+// socket as curl without a share handle would do. With the pool on, close()
+// parks the keep-alive connection and the next connect() picks it up, so
+// the stand-in should log a single connection for the pooled run.
+static void bench_http_keepalive(const char* host, int port, int requests) {
+  printf("[BENCH] %d sequential GETs to %s:%d...\n", requests, host, port);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, host, &addr.sin_addr);
+#ifdef __EMSCRIPTEN__
+  static const char* modes[] = {"fresh", "pooled"};
+  int nmodes = 2;
+#else
+  static const char* modes[] = {"fresh"};
+  int nmodes = 1;
+#endif
+  for (int m = 0; m < nmodes; m++) {
+#ifdef __EMSCRIPTEN__
+    EM_ASM({ Module['directSocketsPool'] = !!$0; }, m);
+#endif
+    std::vector<double> samples;
+    int failed = 0;
+    double start = now_ns();
+    for (int i = 0; i < requests; i++) {
+      double t = now_ns();
+      if (!http_get(&addr, host, port)) failed++;
+      samples.push_back((now_ns() - t) / 1e3);
+    }
+    double elapsed = now_ns() - start;
+    std::sort(samples.begin(), samples.end());
+    printf("[BENCH] http_get_%s_p50: %.1f us (%d/%d failed)\n", modes[m],
+           samples[samples.size() / 2], failed, requests);
+    printf("[BENCH] http_get_%s_rate: %.0f req/s\n", modes[m], requests / (elapsed / 1e9));
+  }
+#ifdef __EMSCRIPTEN__
+  int hits = EM_ASM_INT({ return Module['DirectSockets'].pool().hits; });
+  printf("[BENCH] http_pool_hits: %d\n", hits);
+  EM_ASM({ Module['directSocketsPool'] = false; });
+#endif
+}
+
+int main(int argc, char* argv[]) {
+  printf("=== Direct Sockets Microbenchmarks ===\n\n");
+
+  int iterations = argc >= 2 ? atoi(argv[1]) : 10000;
+
+  bench_wakeup_idle_fds(1000, iterations);
+  bench_poll_subscribe_overhead(64, iterations / 100 + 1);
+  bench_timeout_jitter(1, iterations / 100 + 1);
+  bench_pipe(iterations);
+  bench_socketpair_dgram(iterations);
+  bench_udp_sendto(iterations);
+  bench_accept_rate(iterations / 10 + 1);
+  bench_sendfile(32);
+  bench_writev(iterations);
+  bench_stats_overhead(iterations);
+  bench_syscall_overhead(iterations * 10);
+
+  // Network benchmarks (only if a stand-in server address is provided)
+  if (argc >= 4) {
+    bench_concurrent_connect(argv[2], atoi(argv[3]), 100);
+    bench_small_writes(argv[2], atoi(argv[3]), iterations);
+    bench_record_reads(argv[2], atoi(argv[3]), iterations / 10 + 1);
+    if (argc >= 6) {
+      bench_dns_cold_lookup(argv[2], atoi(argv[4]), atoi(argv[5]), iterations / 100 + 1);
+      bench_happy_eyeballs(atoi(argv[3]), 5);
+    }
+    if (argc >= 7) {
+      bench_http_keepalive(argv[2], atoi(argv[6]), iterations / 10 + 1);
+    }
+  } else {
+    printf("\n[SKIP] connect benchmark - pass <iterations> <host> <port> to run\n");
+    printf("  (add <dns-port> <doh-port> of stress-test/dns/dns_standin.mjs for DNS)\n");
+    printf("  (add <http-port> of stress-test/http/http_standin.mjs for connection reuse)\n");
+  }
+
+  printf("\n=== Done ===\n");
+  return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * bench_envelope.mjs — emit() cost in the JS API, JSON vs binary envelopes
+ *
+ * Usage:
+ *   node bench_envelope.mjs [events]
+ *
+ * Two DirectSocketConnections are wired back to back through in-memory
+ * streams with length-prefixed framing, so nothing here touches the network. For each payload shape and
+ * envelope format it reports:
+ *   [BENCH] envelope_<format>_<payload>_codec: encode + dispatch of one
+ *     event, run synchronously, with the bytes allocated per event (heap
+ *     growth over a run short enough that no GC happens in between)
+ *   [BENCH] envelope_<format>_<payload>: events/s for emit() through the
+ *     streams to the listener on the other side, and bytes on the wire
+ * The script re-runs itself with --expose-gc and a fixed young generation.
+ */
+
+import { spawnSync } from 'child_process';
+import { fileURLToPath } from 'url';
+import { PerformanceObserver } from 'perf_hooks';
+import { DirectSocketConnection } from '../../api/direct_sockets_api.js';
+
+if (typeof gc === 'undefined') {
+    const flags = ['--expose-gc', '--min-semi-space-size=64', '--max-semi-space-size=64'];
+    const r = spawnSync(process.execPath, [...flags, fileURLToPath(import.meta.url), ...process.argv.slice(2)], { stdio: 'inherit' });
+    process.exit(r.status ?? 1);
+}
+
+const events = Number(process.argv[2]) || 50000;
+const textEncoder = new TextEncoder();
+
+let collections = 0;
+new PerformanceObserver((list) => { collections += list.getEntries().length; }).observe({ entryTypes: ['gc'] });
+
+function connectedPair(envelope) {
+    let toA, toB;
+    const never = new Promise(() => {});
+    const queue = { highWaterMark: Infinity };
+    const readA = new ReadableStream({ start(c) { toA = c; } }, queue);
+    const readB = new ReadableStream({ start(c) { toB = c; } }, queue);
+    let wire = 0;
+    const writeA = new WritableStream({ write(chunk) { wire += chunk.byteLength; toB.enqueue(chunk); } });
+    const writeB = new WritableStream({ write(chunk) { toA.enqueue(chunk); } });
+    // Framed, as interned event names need
+    const options = { envelope, framing: 'length-prefixed' };
+    const a = new DirectSocketConnection({ kind: 'tcp', socket: { closed: never }, opened: { readable: readA, writable: writeA }, mode: 'stream', options });
+    const b = new DirectSocketConnection({ kind: 'tcp', socket: { closed: never }, opened: { readable: readB, writable: writeB }, mode: 'stream', options });
+    return { a, b, wire: () => wire };
+}
+
+const payloads = {
+    small: () => ({ seq: 1, user: 'alice', x: 120, y: -45, flags: [true, false] }),
+    bytes_1k: () => new Uint8Array(1024).fill(7),
+};
+
+// What emit() builds and what the receiver parses, minus the streams. The
+// JSON side is the same JSON.stringify + TextEncoder that send() performs.
+// Timing uses the full count; allocation is measured over a short run after
+// it, so that the young generation does not fill up.
+function codec(envelope, make, count) {
+    const { a, b } = connectedPair(envelope);
+    const arg = make();
+    let received = 0;
+    b.on('tick', () => { received++; });
+    const encode = envelope === 'json'
+        ? () => textEncoder.encode(JSON.stringify({ __socketiwa: 1, t: 'event', e: 'tick', args: [arg] }))
+        : () => a._encodeEnvelope({ t: 'event', e: 'tick', args: [arg] });
+    // Warm-up, which also interns the event name
+    for (let i = 0; i < 5000; i++) b._handleStructuredMessage(encode());
+
+    const start = performance.now();
+    for (let i = 0; i < count; i++) b._handleStructuredMessage(encode());
+    const ns = (performance.now() - start) * 1e6 / count;
+
+    const sample = 2000;
+    gc();
+    collections = 0;
+    const heap0 = process.memoryUsage().heapUsed;
+    for (let i = 0; i < sample; i++) b._handleStructuredMessage(encode());
+    const alloc = (process.memoryUsage().heapUsed - heap0) / sample;
+    if (received !== 5000 + count + sample) throw new Error(`lost events: ${received}`);
+    return { ns, alloc, clean: collections === 0 };
+}
+
+async function endToEnd(envelope, make, count) {
+    const { a, b, wire } = connectedPair(envelope);
+    const arg = make();
+    let received = 0;
+    let done;
+    const finished = new Promise((r) => { done = r; });
+    b.on('tick', () => { if (++received === count) done(); });
+    await a.emit('tick', arg);
+    received = 0;
+    const wire0 = wire();
+    const start = performance.now();
+    for (let i = 0; i < count; i++) {
+        a.emit('tick', arg);
+        if ((i & 1023) === 1023) await new Promise((r) => setImmediate(r));
+    }
+    await finished;
+    return { rate: count / ((performance.now() - start) / 1000), wire: (wire() - wire0) / count };
+}
+
+console.log(`=== Envelope benchmark: ${events} events per run ===`);
+for (const [name, make] of Object.entries(payloads)) {
+    for (const envelope of ['json', 'binary']) {
+        const c = codec(envelope, make, events);
+        console.log(`[BENCH] envelope_${envelope}_${name}_codec: ${c.ns.toFixed(0)} ns/event, ` +
+            `${c.alloc.toFixed(0)} B/event allocated${c.clean ? '' : ' (GC ran, allocation undercounted)'}`);
+        await endToEnd(envelope, make, 2000);
+        const r = await endToEnd(envelope, make, events);
+        console.log(`[BENCH] envelope_${envelope}_${name}: ${r.rate.toFixed(0)} events/s, ${r.wire.toFixed(0)} B/event on the wire`);
+    }
+}
+process.exit(0);
@@ -0,0 +1,90 @@
+/**
+ * bench_framing.mjs — stream-mode message throughput with length-prefixed framing
+ *
+ * Usage:
+ *   node bench_framing.mjs [messages]
+ *
+ * Starts a TCP echo stand-in on loopback and connects a DirectSocketConnection
+ * to it (over a TCPSocket shim on node:net when Direct Sockets is absent).
+ * Each run sends a burst of equal-size messages and waits for them all to come
+ * back, then reports
+ *   [BENCH] framing_<size>: <messages/s> msgs/s, <MB/s> MB/s
+ * The unframed line shows what framing fixes: TCP coalesces and splits the
+ * messages, so the 'message' event count no longer matches what was sent.
+ */
+
+import { createServer, connect } from 'net';
+import { DirectSocketConnection } from '../../api/direct_sockets_api.js';
+
+const messages = Number(process.argv[2]) || 20000;
+
+// Just enough of TCPSocket for DirectSocketConnection
+class ShimTCPSocket {
+    constructor(host, port) {
+        const s = connect(port, host);
+        s.setNoDelay(true);
+        this.closed = new Promise((resolve) => s.on('close', resolve));
+        this.close = async () => s.destroy();
+        this.opened = new Promise((resolve, reject) => {
+            s.on('error', reject);
+            s.on('connect', () => resolve({
+                readable: new ReadableStream({
+                    start(c) {
+                        s.on('data', (d) => c.enqueue(new Uint8Array(d.buffer, d.byteOffset, d.byteLength)));
+                        s.on('end', () => c.close());
+                    },
+                }),
+                writable: new WritableStream({
+                    write: (chunk) => new Promise((ok) => { if (s.write(chunk)) ok(); else s.once('drain', ok); }),
+                }),
+            }));
+        });
+    }
+}
+const TCPSocketImpl = globalThis.TCPSocket || ShimTCPSocket;
+
+const echo = createServer((c) => c.pipe(c));
+await new Promise((r) => echo.listen(0, '127.0.0.1', r));
+const port = echo.address().port;
+
+async function run(size, count, framing) {
+    const socket = new TCPSocketImpl('127.0.0.1', port);
+    const opened = await socket.opened;
+    const conn = new DirectSocketConnection({
+        kind: 'tcp', socket, opened, mode: 'stream',
+        options: framing ? { framing: 'length-prefixed' } : {},
+    });
+    conn.binaryType = 'uint8array';
+    const payload = new Uint8Array(size).fill(0x5a);
+    let events = 0, bytes = 0;
+    const expected = size * count;
+    let done;
+    const finished = new Promise((r) => { done = r; });
+    conn.on('message', (m) => {
+        events++;
+        bytes += m.length;
+        if (bytes >= expected) done();
+    });
+    const start = performance.now();
+    const pending = [];
+    for (let i = 0; i < count; i++) {
+        pending.push(conn.send(payload));
+        if (pending.length === 256) await Promise.all(pending.splice(0));
+    }
+    await Promise.all(pending);
+    await finished;
+    const secs = (performance.now() - start) / 1000;
+    await conn.close();
+    return { rate: count / secs, mbps: expected / secs / 1e6, events };
+}
+
+console.log(`=== Framing benchmark: echo stand-in on 127.0.0.1:${port} ===`);
+for (const [label, size, count] of [['64B', 64, messages], ['64KB', 64 * 1024, Math.max(1, messages / 100)]]) {
+    await run(size, Math.min(count, 1000), true);
+    const r = await run(size, count, true);
+    console.log(`[BENCH] framing_${label}: ${r.rate.toFixed(0)} msgs/s, ${r.mbps.toFixed(1)} MB/s (${r.events}/${count} messages)`);
+    const u = await run(size, count, false);
+    console.log(`[BENCH] unframed_${label}: ${u.rate.toFixed(0)} msgs/s, ${u.mbps.toFixed(1)} MB/s (${u.events} 'message' events for ${count} sends)`);
+}
+echo.close();
+process.exit(0);
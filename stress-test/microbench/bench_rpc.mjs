@@ -0,0 +1,94 @@
+/**
+ * bench_rpc.mjs — emitWithAck() round trips with many requests outstanding
+ *
+ * Usage:
+ *   node bench_rpc.mjs [requests] [outstanding]
+ *
+ * Runs an ack echo stand-in in a child process (a DirectSocketConnection per
+ * accepted socket that answers every 'rpc' with its argument) and keeps
+ * `outstanding` emitWithAck() calls in flight against it from one connection,
+ * over a TCPSocket shim on node:net when Direct Sockets is absent. Both ends
+ * use length-prefixed framing. Reports, for this process only:
+ *   [BENCH] rpc_<outstanding>: <rpc/s> rpc/s, p50 <ms> ms, p99 <ms> ms, CPU <us> us/rpc
+ */
+
+import { spawn } from 'child_process';
+import { fileURLToPath } from 'url';
+import { createServer, connect } from 'net';
+import { DirectSocketConnection } from '../../api/direct_sockets_api.js';
+
+const options = { framing: 'length-prefixed' };
+
+function shimOpened(s) {
+    return {
+        readable: new ReadableStream({
+            start(c) {
+                s.on('data', (d) => c.enqueue(new Uint8Array(d.buffer, d.byteOffset, d.byteLength)));
+                s.on('end', () => c.close());
+            },
+        }),
+        writable: new WritableStream({
+            write: (chunk) => new Promise((ok) => { if (s.write(chunk)) ok(); else s.once('drain', ok); }),
+        }),
+    };
+}
+
+function wrap(s) {
+    s.setNoDelay(true);
+    const socket = { closed: new Promise((resolve) => s.on('close', resolve)), close: async () => s.destroy() };
+    return new DirectSocketConnection({ kind: 'tcp', socket, opened: shimOpened(s), mode: 'stream', options });
+}
+
+if (process.argv[2] === '--echo') {
+    const server = createServer((s) => {
+        const conn = wrap(s);
+        conn.on('rpc', (value, respond) => respond(value));
+        conn.on('error', () => {});
+    });
+    server.listen(0, '127.0.0.1', () => console.log(server.address().port));
+    process.stdin.on('end', () => process.exit(0));
+    process.stdin.resume();
+} else {
+    const requests = Number(process.argv[2]) || 200000;
+    const outstanding = Number(process.argv[3]);
+
+    const child = spawn(process.execPath, [fileURLToPath(import.meta.url), '--echo'], { stdio: ['pipe', 'pipe', 'inherit'] });
+    const port = await new Promise((resolve) => child.stdout.once('data', (d) => resolve(Number(d))));
+
+    async function run(count, inFlight) {
+        const s = connect(port, '127.0.0.1');
+        await new Promise((resolve) => s.once('connect', resolve));
+        const conn = wrap(s);
+        const latencies = new Float64Array(count);
+        let next = 0;
+        const cpu = process.cpuUsage();
+        const start = performance.now();
+        async function worker() {
+            while (next < count) {
+                const i = next++;
+                const t0 = performance.now();
+                await conn.emitWithAck('rpc', i, { timeoutMs: 30000 });
+                latencies[i] = performance.now() - t0;
+            }
+        }
+        await Promise.all(Array.from({ length: inFlight }, worker));
+        const secs = (performance.now() - start) / 1000;
+        const used = process.cpuUsage(cpu);
+        await conn.close();
+        latencies.sort();
+        const pct = (p) => latencies[Math.min(count - 1, Math.floor(count * p))];
+        return { rate: count / secs, p50: pct(0.5), p99: pct(0.99), cpu: (used.user + used.system) / count };
+    }
+
+    console.log(`=== RPC benchmark: ${requests} emitWithAck() calls against an echo stand-in on 127.0.0.1:${port} ===`);
+    await run(Math.min(requests, 20000), 100);
+    for (const inFlight of outstanding ? [outstanding] : [100, 10000, 50000]) {
+        const r = await run(requests, inFlight);
+        console.log(
+            `[BENCH] rpc_${inFlight}: ${r.rate.toFixed(0)} rpc/s, p50 ${r.p50.toFixed(2)} ms, ` +
+            `p99 ${r.p99.toFixed(2)} ms, CPU ${r.cpu.toFixed(2)} us/rpc`,
+        );
+    }
+    child.stdin.end();
+    process.exit(0);
+}
@@ -0,0 +1,141 @@
+/**
+ * bench_send_queue.mjs — small-message send throughput on a TCP connection
+ *
+ * Usage:
+ *   node bench_send_queue.mjs [messages] [size]
+ *
+ * Starts a byte-counting sink on loopback and connects a DirectSocketConnection
+ * to it (over a TCPSocket shim on node:net when Direct Sockets is absent). The
+ * sink answers with one byte once everything has arrived. Reports
+ *   [BENCH] send_<mode>_<framing>: <messages/s> msgs/s, <writes> writes, peak bufferedAmount <bytes>
+ * for a burst of un-awaited send() calls and for one awaited send() at a time,
+ * with and without length-prefixed framing (only framed sends are coalesced).
+ * Before timing, it checks over in-memory streams that a burst of emit()
+ * calls reaches the other side without losing events, framed or not.
+ */
+
+import { createServer, connect } from 'net';
+import { DirectSocketConnection } from '../../api/direct_sockets_api.js';
+
+const messages = Number(process.argv[2]) || 10000;
+const size = Number(process.argv[3]) || 100;
+
+// Just enough of TCPSocket for DirectSocketConnection; counts writes
+let writes = 0;
+class ShimTCPSocket {
+    constructor(host, port) {
+        const s = connect(port, host);
+        s.setNoDelay(true);
+        this.closed = new Promise((resolve) => s.on('close', resolve));
+        this.close = async () => s.destroy();
+        this.opened = new Promise((resolve, reject) => {
+            s.on('error', reject);
+            s.on('connect', () => resolve({
+                readable: new ReadableStream({
+                    start(c) {
+                        s.on('data', (d) => c.enqueue(new Uint8Array(d.buffer, d.byteOffset, d.byteLength)));
+                        s.on('end', () => c.close());
+                    },
+                }),
+                writable: new WritableStream({
+                    write: (chunk) => {
+                        writes++;
+                        return new Promise((ok) => { if (s.write(chunk)) ok(); else s.once('drain', ok); });
+                    },
+                }),
+            }));
+        });
+    }
+}
+const TCPSocketImpl = globalThis.TCPSocket || ShimTCPSocket;
+
+// Two connections back to back over in-memory streams, writers with the
+// default highWaterMark of 1 so that a burst backs up behind the first write
+function checkBurstDelivery(framing) {
+    let toB;
+    const never = new Promise(() => {});
+    const options = framing ? { framing: 'length-prefixed' } : {};
+    const readB = new ReadableStream({ start(c) { toB = c; } });
+    const writeA = new WritableStream({ write: (chunk) => new Promise((r) => setTimeout(() => { toB.enqueue(chunk); r(); })) });
+    const a = new DirectSocketConnection({ kind: 'tcp', socket: { closed: never }, opened: { readable: new ReadableStream(), writable: writeA }, mode: 'stream', options });
+    const b = new DirectSocketConnection({ kind: 'tcp', socket: { closed: never }, opened: { readable: readB, writable: new WritableStream() }, mode: 'stream', options });
+    const names = ['x', 'y', 'z'];
+    const got = [];
+    for (const name of names) b.on(name, (i) => got.push(`${name}${i}`));
+    const sent = [];
+    for (let i = 0; i < 300; i++) {
+        const name = names[i % names.length];
+        sent.push(`${name}${i}`);
+        a.emit(name, i);
+    }
+    return new Promise((resolve, reject) => {
+        const deadline = setTimeout(() => reject(new Error(`${framing ? 'framed' : 'unframed'} burst: ${got.length}/${sent.length} events arrived`)), 5000);
+        const poll = setInterval(() => {
+            if (got.length < sent.length) return;
+            clearInterval(poll);
+            clearTimeout(deadline);
+            if (got.join() !== sent.join()) reject(new Error(`${framing ? 'framed' : 'unframed'} burst: events out of order`));
+            else resolve();
+        }, 5);
+    });
+}
+
+let expected = 0;
+const sink = createServer((c) => {
+    let bytes = 0;
+    c.on('data', (d) => {
+        bytes += d.length;
+        if (bytes >= expected) {
+            bytes -= expected;
+            // A one-byte frame, which unframed clients take as a message too
+            c.write(Buffer.from([1, 0x6b]));
+        }
+    });
+});
+await new Promise((r) => sink.listen(0, '127.0.0.1', r));
+const port = sink.address().port;
+
+async function run(awaitEach, framing) {
+    const socket = new TCPSocketImpl('127.0.0.1', port);
+    const opened = await socket.opened;
+    const options = framing ? { framing: 'length-prefixed' } : {};
+    const conn = new DirectSocketConnection({ kind: 'tcp', socket, opened, mode: 'stream', options });
+    expected = messages * (framing ? size + 1 : size);
+    const acked = new Promise((r) => conn.once('message', r));
+    const payload = new Uint8Array(size).fill(0x5a);
+    let peak = 0;
+    writes = 0;
+    const start = performance.now();
+    if (awaitEach) {
+        for (let i = 0; i < messages; i++) await conn.send(payload);
+    } else {
+        const pending = [];
+        for (let i = 0; i < messages; i++) {
+            pending.push(conn.send(payload));
+            peak = Math.max(peak, conn.bufferedAmount ?? 0);
+        }
+        await Promise.all(pending);
+    }
+    await acked;
+    const secs = (performance.now() - start) / 1000;
+    await conn.close();
+    return { rate: messages / secs, writes, peak };
+}
+
+await checkBurstDelivery(false);
+await checkBurstDelivery(true);
+
+console.log(`=== Send queue benchmark: ${messages} x ${size} B to sink on 127.0.0.1:${port} ===`);
+await run(false, true);
+await run(true, true);
+for (const framing of [true, false]) {
+    for (const [label, awaitEach] of [['burst', false], ['awaited', true]]) {
+        const r = await run(awaitEach, framing);
+        console.log(
+            `[BENCH] send_${label}_${framing ? 'framed' : 'unframed'}: ${r.rate.toFixed(0)} msgs/s, ` +
+            `${r.writes} writes, peak bufferedAmount ${r.peak}`,
+        );
+    }
+}
+sink.close();
+process.exit(0);
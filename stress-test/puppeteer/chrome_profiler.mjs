@@ -62,6 +62,8 @@ async function main() {
     categories: [
       'v8', 'v8.wasm', 'v8.wasm.detailed', 'v8.wasm.turbofan',
       'devtools.timeline', 'disabled-by-default-v8.cpu_profiler',
+      // blink.user_timing also carries libdirectsockets.js syscall spans when
+      // the page sets Module.directSocketsTrace = 'user-timing'
       'blink.user_timing', 'loading',
     ],
   });
@@ -14,6 +14,15 @@
 #include <poll.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <time.h>
+#include <limits.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#include <emscripten/direct_sockets_stats.h>
+#endif
 
 static void test_socket_create() {
   printf("[TEST] socket(AF_INET, SOCK_STREAM, 0)...\n");
@@ -279,6 +288,69 @@ static void test_pipe() {
   close(pipefd[1]);
 }
 
+// Test bounded pipe capacity: EAGAIN when full, PIPE_BUF atomicity,
+// F_GETPIPE_SZ / F_SETPIPE_SZ, and POLLOUT coming back after a drain
+static void test_pipe_capacity() {
+  printf("[TEST] pipe capacity, PIPE_BUF atomicity, F_SETPIPE_SZ...\n");
+
+  int pipefd[2];
+  if (pipe2(pipefd, O_NONBLOCK) < 0) {
+    printf("  FAIL: pipe2() errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+
+  int size = fcntl(pipefd[1], F_GETPIPE_SZ);
+  printf("  F_GETPIPE_SZ: %d\n", size);
+
+  // Fill with 1000-byte writes: the last one that doesn't fit whole must
+  // fail with EAGAIN rather than being split (1000 <= PIPE_BUF)
+  static char chunk[8192];
+  ssize_t total = 0;
+  while (true) {
+    ssize_t n = write(pipefd[1], chunk, 1000);
+    if (n < 0) break;
+    if (n != 1000) {
+      printf("  FAIL: atomic write split into %zd bytes\n", n);
+      break;
+    }
+    total += n;
+  }
+  int err = errno;
+  printf("  %s: filled %zd bytes, then errno=%d (expect EAGAIN)\n",
+         err == EAGAIN && total > size - PIPE_BUF - 1000 && total <= size ? "OK" : "FAIL", total, err);
+
+  // A write larger than PIPE_BUF takes whatever still fits (a byte ring
+  // takes the remainder; Linux's page slots may have none left)
+  ssize_t n = write(pipefd[1], chunk, sizeof(chunk));
+  printf("  %s: large write took %zd of %zu bytes\n",
+         (n >= 0 ? n == size - total : errno == EAGAIN) ? "OK" : "FAIL", n, sizeof(chunk));
+
+  struct pollfd pfd = {};
+  pfd.fd = pipefd[1];
+  pfd.events = POLLOUT;
+  int rc = poll(&pfd, 1, 0);
+  printf("  %s: full pipe not writable (poll=%d)\n", rc == 0 ? "OK" : "FAIL", rc);
+
+  // Shrinking below the queued bytes is refused
+  rc = fcntl(pipefd[1], F_SETPIPE_SZ, 4096);
+  printf("  %s: F_SETPIPE_SZ below queued bytes -> %d errno=%d (expect EBUSY)\n",
+         rc < 0 && errno == EBUSY ? "OK" : "FAIL", rc, errno);
+
+  // Drain and check the writer sees POLLOUT again
+  static char sink[65536];
+  while (read(pipefd[0], sink, sizeof(sink)) > 0) {}
+  rc = poll(&pfd, 1, 0);
+  printf("  %s: POLLOUT after drain (revents=0x%x)\n",
+         rc == 1 && (pfd.revents & POLLOUT) ? "OK" : "FAIL", pfd.revents);
+
+  // Sizes round up to a power-of-two number of pages
+  rc = fcntl(pipefd[1], F_SETPIPE_SZ, 5000);
+  printf("  %s: F_SETPIPE_SZ(5000) -> %d (expect 8192)\n", rc == 8192 ? "OK" : "FAIL", rc);
+
+  close(pipefd[0]);
+  close(pipefd[1]);
+}
+
 // Test socketpair() - bidirectional send/recv
 static void test_socketpair() {
   printf("[TEST] socketpair() bidirectional...\n");
@@ -323,6 +395,300 @@ static void test_socketpair() {
   close(sv[1]);
 }
 
+// SOCK_DGRAM / SOCK_SEQPACKET socketpairs keep message boundaries, truncate
+// into short buffers and scatter one message across recvmsg() iovecs.
+static void test_socketpair_dgram() {
+  printf("[TEST] socketpair() SOCK_DGRAM/SOCK_SEQPACKET message boundaries...\n");
+
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sv) < 0) {
+    printf("  FAIL: socketpair(SOCK_DGRAM) errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+
+  send(sv[0], "first", 5, 0);
+  send(sv[0], "second message", 14, 0);
+
+  int avail = -1;
+  ioctl(sv[1], FIONREAD, &avail);
+  printf("  %s: FIONREAD reports next message (%d, expect 5)\n", avail == 5 ? "OK" : "FAIL", avail);
+
+  char buf[64] = {};
+  ssize_t n = recv(sv[1], buf, sizeof(buf), 0);
+  printf("  %s: first recv -> %zd bytes (expect 5, not coalesced)\n", n == 5 ? "OK" : "FAIL", n);
+
+  // Short buffer: the rest of the message is dropped; MSG_TRUNC reports the real length
+  n = recv(sv[1], buf, 6, MSG_TRUNC);
+  printf("  %s: truncated recv -> %zd (expect 14) \"%.6s\"\n",
+         n == 14 && memcmp(buf, "second", 6) == 0 ? "OK" : "FAIL", n, buf);
+  n = recv(sv[1], buf, sizeof(buf), 0);
+  printf("  %s: remainder discarded (recv=%zd errno=%d, expect EAGAIN)\n",
+         n < 0 && errno == EAGAIN ? "OK" : "FAIL", n, errno);
+
+  // sendmsg() gathers two iovecs into one message; recvmsg() scatters it
+  char a[] = "head-", b[] = "tail";
+  struct iovec out[2] = {{a, 5}, {b, 4}};
+  struct msghdr msg = {};
+  msg.msg_iov = out;
+  msg.msg_iovlen = 2;
+  sendmsg(sv[0], &msg, 0);
+
+  char x[3] = {}, y[3] = {};
+  struct iovec in[2] = {{x, sizeof(x)}, {y, sizeof(y)}};
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = in;
+  msg.msg_iovlen = 2;
+  n = recvmsg(sv[1], &msg, 0);
+  printf("  %s: recvmsg -> %zd bytes, msg_flags=0x%x (expect 6, MSG_TRUNC)\n",
+         n == 6 && (msg.msg_flags & MSG_TRUNC) && memcmp(x, "hea", 3) == 0 && memcmp(y, "d-t", 3) == 0
+             ? "OK" : "FAIL", n, msg.msg_flags);
+
+  close(sv[0]);
+  close(sv[1]);
+
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+    printf("  FAIL: socketpair(SOCK_SEQPACKET) errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  write(sv[0], "abc", 3);
+  write(sv[0], "defg", 4);
+  n = read(sv[1], buf, sizeof(buf));
+  ssize_t m = read(sv[1], buf, sizeof(buf));
+  printf("  %s: SEQPACKET reads -> %zd, %zd (expect 3, 4)\n", n == 3 && m == 4 ? "OK" : "FAIL", n, m);
+
+  // Peer closed: reads see EOF
+  close(sv[0]);
+  n = read(sv[1], buf, sizeof(buf));
+  printf("  %s: read after peer close -> %zd (expect 0)\n", n == 0 ? "OK" : "FAIL", n);
+  close(sv[1]);
+}
+
+// A message larger than PIPE_BUF can fail with EAGAIN while POLLOUT is
+// already on. Reads that make room after that must still wake the writer, so
+// an EPOLLET set sees a new EPOLLOUT edge and the message then goes in. The
+// counts assume the bridge's 64 KiB socketpair buffer.
+static void test_socketpair_large_messages() {
+  printf("[TEST] socketpair() SOCK_SEQPACKET messages larger than PIPE_BUF...\n");
+#ifdef __EMSCRIPTEN__
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, sv) < 0) {
+    printf("  FAIL: socketpair(SOCK_SEQPACKET) errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+
+  static char msg[8000], buf[8000];
+  int queued = 0;
+  while (send(sv[0], msg, 1000, 0) == 1000) queued++;
+  for (int i = 0; i < 5; i++) recv(sv[1], buf, sizeof(buf), 0);
+  queued -= 5;
+
+  int ep = epoll_create1(0);
+  struct epoll_event ev = {};
+  ev.events = EPOLLOUT | EPOLLET;
+  epoll_ctl(ep, EPOLL_CTL_ADD, sv[0], &ev);
+  struct epoll_event out[2];
+  int n = epoll_wait(ep, out, 2, 0);
+  int n2 = epoll_wait(ep, out, 2, 0);
+  printf("  %s: POLLOUT on with room for 5 small messages (edge=%d, again=%d)\n",
+         n == 1 && n2 == 0 ? "OK" : "FAIL", n, n2);
+
+  memset(msg, 'L', sizeof(msg));
+  ssize_t rc = send(sv[0], msg, sizeof(msg), 0);
+  printf("  %s: 8000-byte message does not fit yet (rc=%zd errno=%d, expect EAGAIN)\n",
+         rc < 0 && errno == EAGAIN ? "OK" : "FAIL", rc, errno);
+
+  // Still above the POLLOUT threshold, but a new edge for the stalled writer
+  recv(sv[1], buf, sizeof(buf), 0);
+  queued--;
+  n = epoll_wait(ep, out, 2, 0);
+  printf("  %s: read after EAGAIN is an EPOLLOUT edge (n=%d)\n", n == 1 ? "OK" : "FAIL", n);
+
+  for (int i = 0; i < 2; i++, queued--) recv(sv[1], buf, sizeof(buf), 0);
+  rc = send(sv[0], msg, sizeof(msg), 0);
+  printf("  %s: 8000-byte message sent once there is room (rc=%zd)\n", rc == (ssize_t)sizeof(msg) ? "OK" : "FAIL", rc);
+
+  while (queued-- > 0) recv(sv[1], buf, sizeof(buf), 0);
+  rc = recv(sv[1], buf, sizeof(buf), 0);
+  printf("  %s: large message arrives whole (rc=%zd)\n",
+         rc == (ssize_t)sizeof(buf) && buf[0] == 'L' && buf[sizeof(buf) - 1] == 'L' ? "OK" : "FAIL", rc);
+
+  close(ep);
+  close(sv[0]);
+  close(sv[1]);
+#else
+  printf("  [SKIP] not built with -sDIRECT_SOCKETS\n");
+#endif
+}
+
+// A listening socket reports POLLIN once a connection is waiting, and a
+// non-blocking accept4() on an empty queue fails with EAGAIN.
+static void test_listener_poll() {
+  printf("[TEST] listener POLLIN and non-blocking accept4()...\n");
+
+  int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  if (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 4) < 0 ||
+      getsockname(lfd, (struct sockaddr*)&addr, &len) < 0) {
+    printf("  FAIL: listen on loopback errno=%d (%s)\n", errno, strerror(errno));
+    close(lfd);
+    return;
+  }
+
+  struct pollfd pfd = {};
+  pfd.fd = lfd;
+  pfd.events = POLLIN;
+  int rc = poll(&pfd, 1, 0);
+  printf("  %s: idle listener not readable (poll=%d)\n", rc == 0 ? "OK" : "FAIL", rc);
+  int fd = accept4(lfd, nullptr, nullptr, 0);
+  printf("  %s: accept4 on empty queue -> %d errno=%d (expect EAGAIN)\n",
+         fd < 0 && errno == EAGAIN ? "OK" : "FAIL", fd, errno);
+
+  int client = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  connect(client, (struct sockaddr*)&addr, sizeof(addr));
+  rc = poll(&pfd, 1, 2000);
+  printf("  %s: POLLIN after connect (poll=%d revents=0x%x)\n",
+         rc == 1 && (pfd.revents & POLLIN) ? "OK" : "FAIL", rc, pfd.revents);
+
+  struct sockaddr_in peer = {};
+  len = sizeof(peer);
+  fd = accept4(lfd, (struct sockaddr*)&peer, &len, SOCK_NONBLOCK);
+  int flags = fd >= 0 ? fcntl(fd, F_GETFL, 0) : 0;
+  printf("  %s: accept4 -> fd=%d, SOCK_NONBLOCK %s\n",
+         fd >= 0 && (flags & O_NONBLOCK) ? "OK" : "FAIL", fd, (flags & O_NONBLOCK) ? "set" : "missing");
+  rc = poll(&pfd, 1, 0);
+  printf("  %s: queue drained, listener not readable (poll=%d)\n", rc == 0 ? "OK" : "FAIL", rc);
+
+  if (fd >= 0) close(fd);
+  close(client);
+  close(lfd);
+}
+
+// sendfile() with and without an offset pointer: the offset form advances
+// *offset and leaves the file position alone, the other advances the file
+// position.
+static void test_sendfile() {
+  printf("[TEST] sendfile() offset semantics...\n");
+
+  const char* path = "/tmp/test_sendfile.txt";
+  FILE* f = fopen(path, "wb");
+  if (!f) {
+    printf("  FAIL: fopen errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  fputs("0123456789abcdef", f);
+  fclose(f);
+
+  int sv[2];
+  int in = open(path, O_RDONLY);
+  if (in < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+    printf("  FAIL: setup errno=%d (%s)\n", errno, strerror(errno));
+    if (in >= 0) close(in);
+    unlink(path);
+    return;
+  }
+
+  off_t off = 4;
+  ssize_t n = sendfile(sv[0], in, &off, 6);
+  char buf[32] = {};
+  ssize_t r = read(sv[1], buf, sizeof(buf) - 1);
+  off_t pos = lseek(in, 0, SEEK_CUR);
+  printf("  %s: offset form -> %zd \"%.*s\", offset=%ld, position=%ld\n",
+         n == 6 && r == 6 && memcmp(buf, "456789", 6) == 0 && off == 10 && pos == 0 ? "OK" : "FAIL",
+         n, (int)(r > 0 ? r : 0), buf, (long)off, (long)pos);
+
+  n = sendfile(sv[0], in, nullptr, 100);
+  r = read(sv[1], buf, sizeof(buf) - 1);
+  pos = lseek(in, 0, SEEK_CUR);
+  printf("  %s: position form -> %zd bytes (expect 16, short at EOF), position=%ld\n",
+         n == 16 && r == 16 && pos == 16 ? "OK" : "FAIL", n, (long)pos);
+
+  n = sendfile(sv[0], in, nullptr, 100);
+  printf("  %s: at EOF -> %zd\n", n == 0 ? "OK" : "FAIL", n);
+
+  close(in);
+  close(sv[0]);
+  close(sv[1]);
+  unlink(path);
+}
+
+// Test epoll: persistent interest list, level vs edge triggering, and that
+// several pollers (two epoll sets + poll()) watching one fd all see a write.
+static void test_epoll_multi_poller() {
+  printf("[TEST] epoll + poll() watching the same socketpair fd...\n");
+
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+    printf("  FAIL: socketpair() errno=%d (%s)\n", errno, strerror(errno));
+    return;
+  }
+
+  int ep1 = epoll_create1(0);
+  int ep2 = epoll_create1(0);
+  if (ep1 < 0 || ep2 < 0) {
+    printf("  FAIL: epoll_create1() errno=%d (%s)\n", errno, strerror(errno));
+    close(sv[0]);
+    close(sv[1]);
+    return;
+  }
+
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = 0x1122334455667788ULL;
+  int rc1 = epoll_ctl(ep1, EPOLL_CTL_ADD, sv[1], &ev);
+  ev.events = EPOLLIN | EPOLLET;
+  int rc2 = epoll_ctl(ep2, EPOLL_CTL_ADD, sv[1], &ev);
+  printf("  epoll_ctl ADD: %s\n", rc1 == 0 && rc2 == 0 ? "OK" : "FAIL");
+
+  int rc = epoll_ctl(ep1, EPOLL_CTL_ADD, sv[1], &ev);
+  printf("  duplicate ADD: %s (errno=%d)\n", rc < 0 && errno == EEXIST ? "OK" : "FAIL", errno);
+
+  struct epoll_event out[4];
+  int n = epoll_wait(ep1, out, 4, 0);
+  printf("  idle epoll_wait: %s (n=%d)\n", n == 0 ? "OK" : "FAIL", n);
+
+  const char byte = 'x';
+  write(sv[0], &byte, 1);
+
+  struct pollfd pfd = {};
+  pfd.fd = sv[1];
+  pfd.events = POLLIN;
+  rc = poll(&pfd, 1, 0);
+  n = epoll_wait(ep1, out, 4, 0);
+  int n2 = epoll_wait(ep2, out, 4, 0);
+  printf("  after write: poll=%d ep1=%d ep2=%d %s\n", rc, n, n2,
+         rc == 1 && n == 1 && n2 == 1 ? "OK" : "FAIL");
+  printf("  epoll data round-trip: %s\n", out[0].data.u64 == 0x1122334455667788ULL ? "OK" : "FAIL");
+
+  // Level-triggered set reports again; edge-triggered set does not
+  n = epoll_wait(ep1, out, 4, 0);
+  n2 = epoll_wait(ep2, out, 4, 0);
+  printf("  unread data: level=%d edge=%d %s\n", n, n2, n == 1 && n2 == 0 ? "OK" : "FAIL");
+
+  // Removing from one set must not affect the other
+  epoll_ctl(ep2, EPOLL_CTL_DEL, sv[1], nullptr);
+  write(sv[0], &byte, 1);
+  n = epoll_wait(ep1, out, 4, 0);
+  printf("  after DEL on other set: ep1=%d %s\n", n, n == 1 ? "OK" : "FAIL");
+
+  char buf[8];
+  read(sv[1], buf, sizeof(buf));
+  n = epoll_wait(ep1, out, 4, 50);
+  printf("  drained + 50ms timeout: %s (n=%d)\n", n == 0 ? "OK" : "FAIL", n);
+
+  // Peer close reports EPOLLHUP
+  close(sv[0]);
+  n = epoll_wait(ep1, out, 4, 0);
+  printf("  peer close: %s (n=%d, events=0x%x)\n",
+         n == 1 && (out[0].events & EPOLLHUP) ? "OK" : "FAIL", n, n > 0 ? out[0].events : 0);
+
+  close(sv[1]);
+  close(ep1);
+  close(ep2);
+}
+
 // Test getaddrinfo with a real hostname (requires DoH DNS to be working)
 static void test_getaddrinfo_real() {
   printf("[TEST] getaddrinfo(\"dns.google\") - real DNS...\n");
@@ -363,6 +729,52 @@ static void test_getaddrinfo_real() {
   freeaddrinfo(res);
 }
 
+// Test multi-address getaddrinfo and negative caching against the local DNS
+// stand-in (stress-test/dns/dns_standin.mjs, Module.directSocketsDNS set)
+static void test_getaddrinfo_multi() {
+  printf("[TEST] getaddrinfo(\"multi.test\") - all A/AAAA records...\n");
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  struct addrinfo *res = nullptr;
+  int rc = getaddrinfo("multi.test", nullptr, &hints, &res);
+  if (rc != 0) {
+    printf("  SKIP: no DNS stand-in (rc=%d, %s)\n", rc, gai_strerror(rc));
+    return;
+  }
+
+  int v4 = 0, v6 = 0;
+  for (struct addrinfo *p = res; p; p = p->ai_next) {
+    char addr[INET6_ADDRSTRLEN];
+    if (p->ai_family == AF_INET) {
+      inet_ntop(AF_INET, &((struct sockaddr_in*)p->ai_addr)->sin_addr, addr, sizeof(addr));
+      v4++;
+    } else {
+      inet_ntop(AF_INET6, &((struct sockaddr_in6*)p->ai_addr)->sin6_addr, addr, sizeof(addr));
+      v6++;
+    }
+    printf("  resolved: %s (family=%d)\n", addr, p->ai_family);
+  }
+  freeaddrinfo(res);
+  printf("  %s: %d IPv4 + %d IPv6 addresses\n", v4 >= 2 && v6 >= 1 ? "OK" : "FAIL", v4, v6);
+
+  // NXDOMAIN is cached for the SOA MINIMUM, so the repeat lookup never
+  // reaches the network
+  struct timespec t0, t1, t2;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  int rc1 = getaddrinfo("nx.test", nullptr, &hints, &res);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  int rc2 = getaddrinfo("nx.test", nullptr, &hints, &res);
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  double first = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+  double second = (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6;
+  printf("  nx.test: rc=%d in %.2f ms, cached rc=%d in %.2f ms\n", rc1, first, rc2, second);
+  printf("  %s: NXDOMAIN fails and the repeat is served from cache\n",
+         rc1 != 0 && rc2 != 0 && second <= first ? "OK" : "FAIL");
+}
+
 // Test non-blocking recv - set O_NONBLOCK, recv on empty socket, expect EAGAIN
 static void test_nonblocking_recv() {
   printf("[TEST] non-blocking recv (O_NONBLOCK + EAGAIN)...\n");
@@ -403,6 +815,287 @@ static void test_nonblocking_recv() {
   printf("  OK\n");
 }
 
+// Non-blocking connect(), then poll() for POLLOUT. Measures how long after
+// the connection opens the poller is woken (it must not sleep to the timeout).
+static void test_connect_pollout_latency(const char* host, int port) {
+  printf("[TEST] non-blocking connect -> POLLOUT latency to %s:%d...\n", host, port);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    printf("  FAIL: socket() errno=%d\n", errno);
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  struct sockaddr_in server = {};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  inet_pton(AF_INET, host, &server.sin_addr);
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  int rc = connect(fd, (struct sockaddr*)&server, sizeof(server));
+  if (rc < 0 && errno != EINPROGRESS) {
+    printf("  FAIL: connect() errno=%d (%s)\n", errno, strerror(errno));
+    close(fd);
+    return;
+  }
+  printf("  connect returned %d%s\n", rc, rc < 0 ? " (EINPROGRESS)" : "");
+
+  struct pollfd pfd = {};
+  pfd.fd = fd;
+  pfd.events = POLLOUT;
+  rc = poll(&pfd, 1, 5000);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+  if (rc == 1 && (pfd.revents & POLLOUT)) {
+    printf("  OK: POLLOUT after %.3f ms\n", ms);
+  } else {
+    printf("  FAIL: poll returned %d, revents=0x%x after %.3f ms\n", rc, pfd.revents, ms);
+  }
+
+  close(fd);
+}
+
+// recv() flags against the echo server: MSG_DONTWAIT on an idle socket,
+// MSG_PEEK leaves data queued, MSG_WAITALL returns the full request.
+static void test_recv_flags(const char* host, int port) {
+  printf("[TEST] recv flags (MSG_DONTWAIT/MSG_PEEK/MSG_WAITALL) to %s:%d...\n", host, port);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in server = {};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  inet_pton(AF_INET, host, &server.sin_addr);
+  if (connect(fd, (struct sockaddr*)&server, sizeof(server)) < 0) {
+    printf("  FAIL: connect() errno=%d (%s)\n", errno, strerror(errno));
+    close(fd);
+    return;
+  }
+
+  char buf[64] = {};
+  ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+  printf("  MSG_DONTWAIT on idle socket: %s (n=%zd, errno=%d)\n",
+         n < 0 && errno == EAGAIN ? "OK" : "FAIL", n, errno);
+
+  // Two sends so the echo may come back in more than one chunk
+  send(fd, "hello ", 6, 0);
+  send(fd, "world", 5, 0);
+
+  n = recv(fd, buf, 5, MSG_PEEK | MSG_WAITALL);
+  printf("  MSG_PEEK: %s (n=%zd, \"%.*s\")\n",
+         n == 5 && memcmp(buf, "hello", 5) == 0 ? "OK" : "FAIL", n, (int)(n > 0 ? n : 0), buf);
+
+  memset(buf, 0, sizeof(buf));
+  n = recv(fd, buf, 11, MSG_WAITALL);
+  printf("  MSG_WAITALL: %s (n=%zd, \"%.*s\")\n",
+         n == 11 && memcmp(buf, "hello world", 11) == 0 ? "OK" : "FAIL", n, (int)(n > 0 ? n : 0), buf);
+
+  close(fd);
+}
+
+// UDP addressing: sendto() naming the peer of a connected socket is sent
+// (as on Linux), and repeated recvfrom() calls report the same source.
+static void test_udp_sendto_peer() {
+  printf("[TEST] UDP sendto() to the connected peer, recvfrom() source...\n");
+
+  int rx = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  if (bind(rx, (struct sockaddr*)&addr, sizeof(addr)) < 0 || getsockname(rx, (struct sockaddr*)&addr, &len) < 0) {
+    printf("  FAIL: bind on loopback errno=%d (%s)\n", errno, strerror(errno));
+    close(rx);
+    return;
+  }
+  int tx = socket(AF_INET, SOCK_DGRAM, 0);
+  if (connect(tx, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    printf("  FAIL: connect errno=%d (%s)\n", errno, strerror(errno));
+    close(tx);
+    close(rx);
+    return;
+  }
+  struct sockaddr_in self = {};
+  len = sizeof(self);
+  getsockname(tx, (struct sockaddr*)&self, &len);
+
+  int sent = 0;
+  for (int i = 0; i < 3; i++) {
+    if (sendto(tx, "ping", 4, 0, (struct sockaddr*)&addr, sizeof(addr)) == 4) sent++;
+  }
+  printf("  %s: sendto(connected peer) x3 -> %d sent\n", sent == 3 ? "OK" : "FAIL", sent);
+
+  int same = 0;
+  for (int i = 0; i < sent; i++) {
+    struct pollfd pfd = {rx, POLLIN, 0};
+    poll(&pfd, 1, 2000);
+    char buf[8];
+    struct sockaddr_in from = {};
+    socklen_t flen = sizeof(from);
+    if (recvfrom(rx, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr*)&from, &flen) == 4 &&
+        flen == sizeof(from) && from.sin_port == self.sin_port &&
+        from.sin_addr.s_addr == addr.sin_addr.s_addr) {
+      same++;
+    }
+  }
+  printf("  %s: recvfrom source = sender's address %d/%d times\n", same == sent ? "OK" : "FAIL", same, sent);
+
+  close(tx);
+  close(rx);
+}
+
+// Per-socket and global counters from emscripten_direct_sockets_stats():
+// one 5-byte send over loopback, read back with a poll() in between and a
+// second recv() that hits EAGAIN. Syscall counting is turned on first.
+static void test_stats() {
+  printf("[TEST] emscripten_direct_sockets_stats()...\n");
+#ifdef __EMSCRIPTEN__
+  emscripten_direct_sockets_stats_enable(1);
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  if (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 4) < 0 ||
+      getsockname(lfd, (struct sockaddr*)&addr, &len) < 0) {
+    printf("  FAIL: listen on loopback errno=%d (%s)\n", errno, strerror(errno));
+    close(lfd);
+    return;
+  }
+  int client = socket(AF_INET, SOCK_STREAM, 0);
+  if (connect(client, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    printf("  FAIL: connect errno=%d (%s)\n", errno, strerror(errno));
+    close(client);
+    close(lfd);
+    return;
+  }
+  int fd = accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK);
+
+  send(client, "hello", 5, 0);
+  struct pollfd pfd = {};
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  poll(&pfd, 1, 2000);
+  char buf[16];
+  ssize_t n = recv(fd, buf, sizeof(buf), 0);
+  ssize_t again = recv(fd, buf, sizeof(buf), 0);
+  int again_errno = errno;
+
+  direct_sockets_stats_t tx = {}, rx = {}, all = {};
+  emscripten_direct_sockets_stats(client, &tx);
+  emscripten_direct_sockets_stats(fd, &rx);
+  int rc = emscripten_direct_sockets_stats(-1, &all);
+  printf("  %s: sender bytes_out=%llu send_calls=%llu connect_calls=%llu\n",
+         tx.bytes_out == 5 && tx.send_calls == 1 && tx.connect_calls == 1 ? "OK" : "FAIL",
+         (unsigned long long)tx.bytes_out, (unsigned long long)tx.send_calls,
+         (unsigned long long)tx.connect_calls);
+  printf("  %s: receiver bytes_in=%llu recv_calls=%llu eagain=%llu (recv=%zd, then %zd errno=%d)\n",
+         n == 5 && again < 0 && again_errno == EAGAIN && rx.bytes_in == 5 && rx.recv_calls == 2 &&
+         rx.eagain == 1 ? "OK" : "FAIL",
+         (unsigned long long)rx.bytes_in, (unsigned long long)rx.recv_calls,
+         (unsigned long long)rx.eagain, n, again, again_errno);
+  printf("  %s: receiver queue depth=%llu max=%llu, poll wakeups=%llu\n",
+         rx.recv_queue_depth == 0 && rx.max_recv_queue_depth >= 1 ? "OK" : "FAIL",
+         (unsigned long long)rx.recv_queue_depth, (unsigned long long)rx.max_recv_queue_depth,
+         (unsigned long long)rx.poll_wakeups);
+  printf("  %s: global open_sockets=%llu syscalls=%llu poll_calls=%llu suspended=%.2fms\n",
+         rc == 0 && all.open_sockets >= 3 && all.syscalls >= tx.syscalls + rx.syscalls &&
+         all.poll_calls >= 1 ? "OK" : "FAIL",
+         (unsigned long long)all.open_sockets, (unsigned long long)all.syscalls,
+         (unsigned long long)all.poll_calls, all.suspended_ms);
+  rc = emscripten_direct_sockets_stats(0, &all);
+  printf("  %s: non-socket fd -> %d\n", rc == -1 ? "OK" : "FAIL", rc);
+
+  if (fd >= 0) close(fd);
+  close(client);
+  close(lfd);
+#else
+  printf("  [SKIP] not built with -sDIRECT_SOCKETS\n");
+#endif
+}
+
+// Trace Event recording: a socket() and a non-blocking recv() show up in
+// the ring as complete events with their fd and return value.
+static void test_trace() {
+  printf("[TEST] Module.DirectSockets.trace()...\n");
+#ifdef __EMSCRIPTEN__
+  EM_ASM({ DIRECT_SOCKETS_TRACE.init(256); });
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  char buf[8];
+  recv(fd, buf, sizeof(buf), 0);
+  int ok = EM_ASM_INT({
+    var events = Module['DirectSockets'].trace(true).traceEvents;
+    var sock = events.find((e) => e.name == 'socket');
+    var recv = events.find((e) => e.name == 'recvfrom');
+    return !!(sock && sock.ph == 'X' && sock.args.ret == $0 && recv && recv.args.fd == $0 && recv.args.ret < 0);
+  }, fd);
+  printf("  %s: socket and recvfrom events recorded\n", ok ? "OK" : "FAIL");
+  EM_ASM({ DIRECT_SOCKETS_TRACE.on = false; });
+  close(fd);
+#else
+  printf("  [SKIP] not built with -sDIRECT_SOCKETS\n");
+#endif
+}
+
+// Connection pool: with Module.directSocketsPool on, a second connect() to
+// the same loopback listener after close() reuses the parked connection, so
+// no new connection reaches accept4() and data still flows on the first
+// accepted fd.
+static void test_pool() {
+  printf("[TEST] Module.directSocketsPool connection reuse...\n");
+#ifdef __EMSCRIPTEN__
+  int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  socklen_t len = sizeof(addr);
+  if (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 4) < 0 ||
+      getsockname(lfd, (struct sockaddr*)&addr, &len) < 0) {
+    printf("  FAIL: listen on loopback errno=%d (%s)\n", errno, strerror(errno));
+    close(lfd);
+    return;
+  }
+  EM_ASM({ Module['directSocketsPool'] = true; });
+  int hits = EM_ASM_INT({ return Module['DirectSockets'].pool().hits; });
+
+  int client = socket(AF_INET, SOCK_STREAM, 0);
+  connect(client, (struct sockaddr*)&addr, sizeof(addr));
+  struct pollfd pfd = {};
+  pfd.fd = lfd;
+  pfd.events = POLLIN;
+  poll(&pfd, 1, 2000);
+  int server = accept4(lfd, nullptr, nullptr, 0);
+  char buf[16];
+  send(client, "one", 3, 0);
+  recv(server, buf, sizeof(buf), 0);
+  send(server, "ack", 3, 0);
+  recv(client, buf, sizeof(buf), 0);
+  close(client);
+
+  client = socket(AF_INET, SOCK_STREAM, 0);
+  int rc = connect(client, (struct sockaddr*)&addr, sizeof(addr));
+  int reused = EM_ASM_INT({ return Module['DirectSockets'].pool().hits; }) - hits;
+  printf("  %s: reconnect -> %d, pool hits +%d\n", rc == 0 && reused == 1 ? "OK" : "FAIL", rc, reused);
+  int fd = accept4(lfd, nullptr, nullptr, 0);
+  printf("  %s: no new connection at the listener (accept4=%d errno=%d)\n",
+         fd < 0 && errno == EAGAIN ? "OK" : "FAIL", fd, errno);
+  send(client, "two", 3, 0);
+  ssize_t n = recv(server, buf, sizeof(buf), 0);
+  printf("  %s: data arrives on the first accepted fd (%zd bytes)\n",
+         n == 3 && memcmp(buf, "two", 3) == 0 ? "OK" : "FAIL", n);
+
+  EM_ASM({ Module['directSocketsPool'] = false; });
+  if (fd >= 0) close(fd);
+  close(client);
+  close(server);
+  close(lfd);
+#else
+  printf("  [SKIP] not built with -sDIRECT_SOCKETS\n");
+#endif
+}
+
 int main(int argc, char* argv[]) {
   printf("=== Direct Sockets Test Suite ===\n\n");
 
@@ -416,13 +1109,26 @@ int main(int argc, char* argv[]) {
   test_poll_immediate();
   test_poll_timeout();
   test_pipe();
+  test_pipe_capacity();
   test_socketpair();
+  test_socketpair_dgram();
+  test_socketpair_large_messages();
+  test_sendfile();
+  test_epoll_multi_poller();
+  test_listener_poll();
+  test_udp_sendto_peer();
+  test_stats();
+  test_trace();
+  test_pool();
   test_getaddrinfo_real();
+  test_getaddrinfo_multi();
   test_nonblocking_recv();
 
   // Network test (only if address provided)
   if (argc >= 3) {
     test_tcp_echo(argv[1], atoi(argv[2]));
+    test_connect_pollout_latency(argv[1], atoi(argv[2]));
+    test_recv_flags(argv[1], atoi(argv[2]));
   } else {
     printf("\n[SKIP] TCP echo test - pass <host> <port> to run\n");
     printf("  e.g.: test 127.0.0.1 7777\n");